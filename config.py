@@ -12,7 +12,14 @@ main.cpp
 ''')
 
 src.add(path='base', sources='''
+arena.cpp
+arena.hpp
+array.cpp
 array.hpp
+bc1.cpp
+bc1.hpp
+cache.cpp
+cache.hpp
 chunk.cpp
 chunk.hpp
 file.cpp
@@ -23,14 +30,25 @@ log.cpp
 log.hpp
 mat.cpp
 mat.hpp
+memory.cpp
+memory.hpp
 orientation.cpp
 orientation.hpp
 quat.cpp
+radix.cpp
+radix.hpp
 random.cpp
 random.hpp
 range.hpp
 shader.cpp
 shader.hpp
+snapshot.cpp
+snapshot.hpp
+stream.cpp
+stream.hpp
+task.cpp
+task.hpp
+timer.hpp
 vec.hpp
 ''')
 
@@ -54,17 +72,40 @@ world.hpp
 ''')
 
 src.add(path='graphics', sources='''
+atlas.cpp
+atlas.hpp
+bake.cpp
+bake.hpp
 color.cpp
 color.hpp
 defs.hpp
+frustum.cpp
+frustum.hpp
+mesh.cpp
+mesh.hpp
+renderer.hpp
+resources.cpp
+resources.hpp
 shader.cpp
 shader.hpp
+soft.cpp
+soft.hpp
 sprite.cpp
 sprite.hpp
+state.cpp
+state.hpp
 system.cpp
 system.hpp
+terrain.cpp
+terrain.hpp
+text.cpp
+text.hpp
 transform.cpp
 transform.hpp
+uniforms.cpp
+uniforms.hpp
+view.cpp
+view.hpp
 ''')
 
 icon = sglib.Icon(base=__file__, path='icon', sources='''
@@ -0,0 +1,17 @@
+#version 130
+
+// The text box and text, in normalized device coordinates.
+in vec2 in_pos;
+in vec2 in_texcoord;
+in vec4 in_color;
+in float in_mode;
+out vec2 ex_texcoord;
+out vec4 ex_color;
+out float ex_mode;
+
+void main() {
+    ex_texcoord = in_texcoord;
+    ex_color = in_color;
+    ex_mode = in_mode;
+    gl_Position = vec4(in_pos, 0.0, 1.0);
+}
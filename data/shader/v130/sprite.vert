@@ -1,14 +1,40 @@
 #version 130
 
-in vec3 in_vert;
-in vec2 in_texcoord;
+// One record per sprite.  The quad corner comes either from a
+// separate per-vertex buffer (instanced) or from the record itself.
+in vec3 in_pos;
+in vec4 in_rect;
+in vec2 in_center;
+in vec2 in_corner;
+in uint in_orient;
 out vec2 ex_texcoord;
 
-uniform mat4 u_modelview;
+uniform mat4 u_worldview;
 uniform mat4 u_projection;
 uniform vec2 u_texscale;
+uniform vec3 u_right;
+uniform vec3 u_up;
 
 void main() {
-    ex_texcoord = in_texcoord * u_texscale;
-    gl_Position = u_projection * (u_modelview * vec4(in_vert, 1.0));
+    vec3 up = (in_orient & 4u) != 0u ? -u_up : u_up;
+    vec3 nright, nup;
+    uint rot = in_orient & 3u;
+    if (rot == 0u) {
+        nright = u_right; nup = up;
+    } else if (rot == 1u) {
+        nright = up; nup = -u_right;
+    } else if (rot == 2u) {
+        nright = -u_right; nup = -up;
+    } else {
+        nright = -up; nup = u_right;
+    }
+
+    vec2 size = in_rect.zw;
+    vec2 local = in_corner * size - vec2(in_center.x, size.y - in_center.y);
+    vec3 pos = in_pos + nright * local.x + nup * local.y;
+    vec2 texcoord = in_rect.xy +
+        vec2(in_corner.x, 1.0 - in_corner.y) * size;
+
+    ex_texcoord = texcoord * u_texscale;
+    gl_Position = u_projection * (u_worldview * vec4(pos, 1.0));
 }
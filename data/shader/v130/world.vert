@@ -7,8 +7,9 @@ in vec3 in_normal;
 out vec3 ex_color;
 flat out vec3 ex_light;
 
-uniform mat4 u_modelview;
+uniform mat4 u_worldview;
 uniform mat4 u_projection;
+uniform vec3 u_vertex_scale;
 uniform mat3 u_normalmat;
 
 uniform vec4 u_terrain_color[8];
@@ -28,5 +29,6 @@ void main() {
     }
     ex_light = light;
 
-    gl_Position = u_projection * (u_modelview * vec4(in_vert.xyz, 1.0));
+    gl_Position = u_projection *
+        (u_worldview * vec4(in_vert.xyz * u_vertex_scale, 1.0));
 }
@@ -0,0 +1,22 @@
+#version 130
+
+// Terrain with precomputed color and lighting, see world.vert.
+// Light is stored divided by 2.0, to fit in a normalized byte.
+const float LIGHT_SCALE = 2.0;
+
+in vec4 in_vert;
+in vec3 in_color;
+in vec3 in_light;
+out vec3 ex_color;
+flat out vec3 ex_light;
+
+uniform mat4 u_worldview;
+uniform mat4 u_projection;
+uniform vec3 u_vertex_scale;
+
+void main() {
+    ex_color = in_color;
+    ex_light = in_light * LIGHT_SCALE;
+    gl_Position = u_projection *
+        (u_worldview * vec4(in_vert.xyz * u_vertex_scale, 1.0));
+}
@@ -0,0 +1,22 @@
+#version 140
+
+// Mode 0 is an image with alpha testing, mode 1 is text, with
+// coverage in the red channel.
+in vec2 ex_texcoord;
+in vec4 ex_color;
+in float ex_mode;
+out vec4 out_color;
+
+uniform sampler2D u_texture;
+
+void main() {
+    vec4 sample = texture(u_texture, ex_texcoord);
+    if (ex_mode < 0.5) {
+        if (sample.a < 0.5) {
+            discard;
+        }
+        out_color = vec4(sample.rgb, 1.0) * ex_color;
+    } else {
+        out_color = ex_color * sample.r;
+    }
+}
@@ -7,7 +7,8 @@ uniform sampler2D u_texture;
 
 void main() {
     vec4 sample = texture(u_texture, ex_texcoord);
-    if (sample.a < 0.5) {
+    // Only discard fully transparent texels, the rest are blended.
+    if (sample.a < 1.0 / 255.0) {
         discard;
     }
     out_color = sample;
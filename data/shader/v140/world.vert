@@ -7,13 +7,20 @@ in vec3 in_normal;
 out vec3 ex_color;
 flat out vec3 ex_light;
 
-uniform mat4 u_modelview;
-uniform mat4 u_projection;
-uniform mat3 u_normalmat;
+layout(std140) uniform Camera {
+    mat4 u_worldview;
+    mat4 u_projection;
+    vec3 u_right;
+    vec3 u_up;
+};
 
-uniform vec4 u_terrain_color[8];
-uniform vec3 u_light_dir[LIGHT_COUNT];
-uniform vec3 u_light_color[LIGHT_COUNT];
+layout(std140) uniform World {
+    vec3 u_vertex_scale;
+    mat3 u_normalmat;
+    vec4 u_terrain_color[8];
+    vec3 u_light_dir[LIGHT_COUNT];
+    vec3 u_light_color[LIGHT_COUNT];
+};
 
 void main() {
     int index = int(in_vert.w) + 2;
@@ -28,5 +35,6 @@ void main() {
     }
     ex_light = light;
 
-    gl_Position = u_projection * (u_modelview * vec4(in_vert.xyz, 1.0));
+    gl_Position = u_projection *
+        (u_worldview * vec4(in_vert.xyz * u_vertex_scale, 1.0));
 }
@@ -0,0 +1,35 @@
+#version 140
+
+// Terrain with precomputed color and lighting, see world.vert.
+// Light is stored divided by 2.0, to fit in a normalized byte.
+const float LIGHT_SCALE = 2.0;
+
+in vec4 in_vert;
+in vec3 in_color;
+in vec3 in_light;
+out vec3 ex_color;
+flat out vec3 ex_light;
+
+layout(std140) uniform Camera {
+    mat4 u_worldview;
+    mat4 u_projection;
+    vec3 u_right;
+    vec3 u_up;
+};
+
+// Only the scale is used, but the layout must match world.vert.
+const int LIGHT_COUNT = 4;
+layout(std140) uniform World {
+    vec3 u_vertex_scale;
+    mat3 u_normalmat;
+    vec4 u_terrain_color[8];
+    vec3 u_light_dir[LIGHT_COUNT];
+    vec3 u_light_color[LIGHT_COUNT];
+};
+
+void main() {
+    ex_color = in_color;
+    ex_light = in_light * LIGHT_SCALE;
+    gl_Position = u_projection *
+        (u_worldview * vec4(in_vert.xyz * u_vertex_scale, 1.0));
+}
@@ -0,0 +1,130 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "arena.hpp"
+#include "log.hpp"
+#include <cstdlib>
+#if defined LD_ALLOC_COUNT
+#include <new>
+#endif
+namespace Base {
+
+namespace {
+
+/// Minimum size of a block.
+const std::size_t ARENA_MIN_BLOCK = 64 * 1024;
+
+char *alloc_block(std::size_t size) {
+    void *ptr = std::malloc(size);
+    if (!ptr) {
+        Log::abort("Out of memory.");
+    }
+    return static_cast<char *>(ptr);
+}
+
+}
+
+Arena frame_arena;
+
+Arena::Arena()
+    : m_data(nullptr), m_pos(0), m_size(0), m_capacity(0)
+{ }
+
+Arena::~Arena() {
+    for (char *block : m_full) {
+        std::free(block);
+    }
+    std::free(m_data);
+}
+
+void *Arena::allocate(std::size_t size, std::size_t align) {
+    std::size_t pos = (m_pos + align - 1) & ~(align - 1);
+    if (pos > m_size || size > m_size - pos) {
+        grow(size);
+        pos = 0;
+    }
+    m_pos = pos + size;
+    return m_data + pos;
+}
+
+void Arena::reset() {
+    if (!m_full.empty()) {
+        for (char *block : m_full) {
+            std::free(block);
+        }
+        m_full.clear();
+        std::free(m_data);
+        m_data = alloc_block(m_capacity);
+        m_size = m_capacity;
+    }
+    m_pos = 0;
+}
+
+std::size_t Arena::used() const {
+    return m_capacity - m_size + m_pos;
+}
+
+void Arena::grow(std::size_t size) {
+    std::size_t bsize = m_size * 2;
+    if (bsize < ARENA_MIN_BLOCK) {
+        bsize = ARENA_MIN_BLOCK;
+    }
+    if (bsize < size) {
+        bsize = size;
+    }
+    if (m_data) {
+        m_full.push_back(m_data);
+    }
+    m_data = alloc_block(bsize);
+    m_pos = 0;
+    m_size = bsize;
+    m_capacity += bsize;
+}
+
+#if defined LD_ALLOC_COUNT
+
+namespace {
+// Counted per thread, so background workers do not show up in the
+// main thread's frames.
+thread_local unsigned long alloc_counter;
+}
+
+unsigned long heap_alloc_count() {
+    return alloc_counter;
+}
+
+#else
+
+unsigned long heap_alloc_count() {
+    return 0;
+}
+
+#endif
+
+}
+
+#if defined LD_ALLOC_COUNT
+
+void *operator new(std::size_t size) {
+    Base::alloc_counter++;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+#endif
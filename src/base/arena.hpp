@@ -0,0 +1,113 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_ARENA_HPP
+#define LD_BASE_ARENA_HPP
+#include <cstddef>
+#include <string>
+#include <vector>
+namespace Base {
+
+/// Bump allocator for data which lives until the arena is reset.
+/// Freeing memory does nothing, everything is reclaimed at once by
+/// reset().  If the arena runs out of space it allocates more, and
+/// the next reset() merges everything into one block, so once the
+/// arena has grown to fit a typical frame it stops allocating.  Not
+/// thread safe.
+class Arena {
+private:
+    char *m_data;
+    std::size_t m_pos;
+    std::size_t m_size;
+    // Full blocks, freed at the next reset.
+    std::vector<char *> m_full;
+    // Total size of all blocks.
+    std::size_t m_capacity;
+
+public:
+    Arena();
+    Arena(const Arena &) = delete;
+    ~Arena();
+    Arena &operator=(const Arena &) = delete;
+
+    /// Allocate memory.  The alignment must be a power of two, no
+    /// larger than alignof(std::max_align_t).
+    void *allocate(std::size_t size, std::size_t align);
+    /// Allocate an array of objects, which are not constructed.
+    template<typename T>
+    T *allocate_array(std::size_t count) {
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+    /// Free all memory allocated from the arena.
+    void reset();
+    /// Get the number of bytes used since the last reset, including
+    /// space left over at the end of full blocks.
+    std::size_t used() const;
+
+private:
+    void grow(std::size_t size);
+};
+
+/// Arena for data which only lasts for the current frame.  It is reset
+/// at the start of each frame, on the main thread.
+extern Arena frame_arena;
+
+/// Allocator for standard containers which allocates from an arena.
+/// The container must not outlive the arena's next reset.
+template<typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    Arena *arena;
+
+    ArenaAllocator()
+        : arena(&frame_arena) { }
+    explicit ArenaAllocator(Arena &a)
+        : arena(&a) { }
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other)
+        : arena(other.arena) { }
+
+    T *allocate(std::size_t n) {
+        return arena->allocate_array<T>(n);
+    }
+    void deallocate(T *ptr, std::size_t n) {
+        (void) ptr;
+        (void) n;
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T> &x, const ArenaAllocator<U> &y) {
+    return x.arena == y.arena;
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &x, const ArenaAllocator<U> &y) {
+    return x.arena != y.arena;
+}
+
+/// Vector which allocates from the frame arena.
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+/// String which allocates from the frame arena.
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>
+    FrameString;
+
+/// Whether heap allocations are counted.  Build with LD_ALLOC_COUNT
+/// defined to count them, which replaces the global operator new.
+#if defined LD_ALLOC_COUNT
+const bool ALLOC_COUNT = true;
+#else
+const bool ALLOC_COUNT = false;
+#endif
+
+/// Get the number of times operator new has been called on the
+/// calling thread, or zero if allocations are not counted.
+unsigned long heap_alloc_count();
+
+}
+#endif
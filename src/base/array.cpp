@@ -0,0 +1,57 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "array.hpp"
+#include <cstdint>
+#include <cstdlib>
+namespace Base {
+
+void *array_alloc(std::size_t size, std::size_t align) {
+    // The pointer from malloc is stored just before the aligned block.
+    std::size_t extra = align - 1 + sizeof(void *);
+    if (size > std::numeric_limits<std::size_t>::max() - extra)
+        Log::abort("out of memory");
+    void *base = std::malloc(size + extra);
+    if (!base)
+        Log::abort("out of memory");
+    std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(base) +
+        sizeof(void *);
+    addr = (addr + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+    void **ptr = reinterpret_cast<void **>(addr);
+    ptr[-1] = base;
+    return ptr;
+}
+
+void array_free(void *ptr) {
+    if (ptr)
+        std::free(static_cast<void **>(ptr)[-1]);
+}
+
+std::size_t array_grow(ArrayGrowth growth, std::size_t capacity,
+                       std::size_t total) {
+    const std::size_t max = std::numeric_limits<std::size_t>::max();
+    switch (growth) {
+    case ArrayGrowth::POW2: {
+        std::size_t rounded = 1;
+        while (rounded < total) {
+            if (rounded > max / 2)
+                return total;
+            rounded *= 2;
+        }
+        return rounded;
+    }
+
+    case ArrayGrowth::HALF: {
+        std::size_t grown = capacity > max - capacity / 2 ?
+            max : capacity + capacity / 2;
+        return grown > total ? grown : total;
+    }
+
+    case ArrayGrowth::EXACT:
+        break;
+    }
+    return total;
+}
+
+}
@@ -6,136 +6,276 @@
 #define LD_BASE_ARRAY_HPP
 #include "log.hpp"
 #include "sg/opengl.h"
+#include <cstddef>
+#include <cstring>
 #include <limits>
-#include <new>
-#include <cstdlib>
+#include <type_traits>
 namespace Base {
 
-// OpenGL attribute array class.
-template<class T>
+/// How an Array grows when it runs out of space.
+enum class ArrayGrowth {
+    /// Round up to a power of two.  Few reallocations, but up to half
+    /// of the space may be unused.
+    POW2,
+    /// Grow by at least half of the current capacity.
+    HALF,
+    /// Grow to exactly the requested size.
+    EXACT
+};
+
+/// Allocate memory with the given alignment, which must be a power of
+/// two.  Aborts if out of memory.
+void *array_alloc(std::size_t size, std::size_t align);
+
+/// Free memory allocated with array_alloc().
+void array_free(void *ptr);
+
+/// Get the capacity to grow an array to.
+std::size_t array_grow(ArrayGrowth growth, std::size_t capacity,
+                       std::size_t total);
+
+// OpenGL attribute array class.  Elements are moved with memcpy, so
+// they must be trivially copyable.  Storage is aligned to Align bytes
+// so SIMD code can write to it.  The first Inline elements are stored
+// in the array object itself, and only larger arrays use the heap.
+template<class T, std::size_t Inline = 0, std::size_t Align = 16>
 class Array {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Array elements are moved with memcpy");
+    static_assert(Align >= alignof(T) && (Align & (Align - 1)) == 0,
+                  "invalid alignment");
+
 private:
     T *m_data;
-    unsigned m_count;
-    unsigned m_alloc;
+    std::size_t m_count;
+    std::size_t m_alloc;
+    ArrayGrowth m_growth;
+    // Range of elements changed since the last upload.
+    std::size_t m_dirty[2];
+    // Number of elements in the OpenGL buffer after the last upload.
+    std::size_t m_uploaded;
+    alignas(Align) unsigned char m_inline[Inline ? Inline * sizeof(T) : 1];
 
 public:
-    explicit Array();
+    explicit Array(ArrayGrowth growth = ArrayGrowth::POW2);
     Array(const Array &other) = delete;
     Array(Array &&other);
     ~Array();
     Array &operator=(const Array &other) = delete;
     Array &operator=(Array &&other);
 
+    T &operator[](std::size_t i) { return m_data[i]; }
+    const T &operator[](std::size_t i) const { return m_data[i]; }
+    /// Get a pointer to the first element.
+    T *data() { return m_data; }
+    const T *data() const { return m_data; }
     /// Get the number of elements in the array.
-    unsigned size() const;
+    std::size_t size() const { return m_count; }
     /// Determine whether the array is empty.
-    bool empty() const;
+    bool empty() const { return m_count == 0; }
+    /// Get the number of elements allocated.
+    std::size_t capacity() const { return m_alloc; }
+    /// Set how the array grows when it runs out of space.
+    void set_growth(ArrayGrowth growth) { m_growth = growth; }
     /// Set the number of elements in the array to zero.
     void clear();
     /// Reserve space for the given total number of elements.
     void reserve(std::size_t total);
+    /// Set the number of elements.  New elements are uninitialized.
+    void resize(std::size_t count);
+    /// Release unused space.  Small arrays move back to inline storage.
+    void shrink_to_fit();
     /// Insert the given number of elements and return a pointer to the first.
     T *insert(std::size_t count);
     /// Set the end of the array.  Must be within the array, or at the end.
-    void set_end(T* end);
+    void set_end(T *end);
+
+    /// Mark elements as changed, so they are sent by upload_dirty().
+    /// Elements added by insert() are marked automatically.
+    void mark_dirty(std::size_t first, std::size_t count);
     /// Upload the array to an OpenGL buffer.
     void upload(GLenum usage);
+    /// Upload part of the array to the OpenGL buffer, which must
+    /// already contain those elements.
+    void upload_range(std::size_t first, std::size_t count);
+    /// Upload the elements which changed since the last upload.  The
+    /// whole array is uploaded if the buffer is too small.
+    void upload_dirty(GLenum usage);
+
+private:
+    T *inline_data() { return reinterpret_cast<T *>(m_inline); }
+    bool is_inline() const {
+        return Inline && m_data == reinterpret_cast<const T *>(m_inline);
+    }
+    void reallocate(std::size_t capacity);
+    void take(Array &other);
 };
 
-template<class T>
-inline Array<T>::Array()
-    : m_data(nullptr), m_count(0), m_alloc(0)
-{ }
+template<class T, std::size_t Inline, std::size_t Align>
+Array<T, Inline, Align>::Array(ArrayGrowth growth)
+    : m_data(nullptr), m_count(0), m_alloc(0), m_growth(growth),
+      m_uploaded(0) {
+    m_dirty[0] = m_dirty[1] = 0;
+    if (Inline) {
+        m_data = inline_data();
+        m_alloc = Inline;
+    }
+}
 
-template<class T>
-inline Array<T>::Array(Array<T> &&other)
-    : m_data(nullptr), m_count(0), m_alloc(0) {
-    m_data = other.m_data;
-    m_count = other.m_count;
-    m_alloc = other.m_alloc;
-    other.m_data = nullptr;
-    other.m_count = 0;
-    other.m_alloc = 0;
+template<class T, std::size_t Inline, std::size_t Align>
+Array<T, Inline, Align>::Array(Array &&other)
+    : Array(other.m_growth) {
+    take(other);
 }
 
-template<class T>
-inline Array<T>::~Array() {
-    std::free(m_data);
+template<class T, std::size_t Inline, std::size_t Align>
+Array<T, Inline, Align>::~Array() {
+    if (!is_inline())
+        array_free(m_data);
 }
 
-template<class T>
-Array<T> &Array<T>::operator=(Array<T> &&other) {
+template<class T, std::size_t Inline, std::size_t Align>
+Array<T, Inline, Align> &Array<T, Inline, Align>::operator=(Array &&other) {
     if (this == &other)
         return *this;
-    std::free(m_data);
-    m_data = other.m_data;
+    if (!is_inline())
+        array_free(m_data);
+    m_data = Inline ? inline_data() : nullptr;
+    m_alloc = Inline;
+    m_growth = other.m_growth;
+    take(other);
+    return *this;
+}
+
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::take(Array &other) {
+    if (other.is_inline()) {
+        std::memcpy(m_data, other.m_data, other.m_count * sizeof(T));
+    } else {
+        m_data = other.m_data;
+        m_alloc = other.m_alloc;
+        other.m_data = Inline ? other.inline_data() : nullptr;
+        other.m_alloc = Inline;
+    }
     m_count = other.m_count;
-    m_alloc = other.m_alloc;
-    other.m_data = nullptr;
+    m_dirty[0] = other.m_dirty[0];
+    m_dirty[1] = other.m_dirty[1];
+    m_uploaded = other.m_uploaded;
     other.m_count = 0;
-    other.m_alloc = 0;
-    return *this;
+    other.m_dirty[0] = other.m_dirty[1] = 0;
+    other.m_uploaded = 0;
 }
 
-template<class T>
-unsigned Array<T>::size() const {
-    return m_count;
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::clear() {
+    m_count = 0;
+    m_dirty[0] = m_dirty[1] = 0;
 }
 
-template<class T>
-bool Array<T>::empty() const {
-    return m_count == 0;
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::reserve(std::size_t total) {
+    if (m_alloc >= total)
+        return;
+    reallocate(array_grow(m_growth, m_alloc, total));
 }
 
-template<class T>
-void Array<T>::clear() {
-    m_count = 0;
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::resize(std::size_t count) {
+    if (count > m_count)
+        insert(count - m_count);
+    else
+        m_count = count;
 }
 
-template<class T>
-void Array<T>::reserve(std::size_t total) {
-    std::size_t rounded;
-    if (total > std::numeric_limits<unsigned>::max())
-        Log::abort("out of memory");
-    if (static_cast<size_t>(m_alloc) >= total)
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::shrink_to_fit() {
+    if (is_inline() || m_count == m_alloc)
         return;
-    rounded = total - 1;
-    rounded |= rounded >> 1;
-    rounded |= rounded >> 2;
-    rounded |= rounded >> 4;
-    rounded |= rounded >> 8;
-    rounded |= rounded >> 16;
-    rounded += 1;
-    if (rounded >= (unsigned) -1)
-        Log::abort("out of memory");
-    T *newdata = static_cast<T *>(std::realloc(m_data, sizeof(T) * rounded));
-    if (!newdata)
-        Log::abort("out of memory");
-    m_data = newdata;
-    m_alloc = (unsigned) rounded;
+    if (m_count <= Inline) {
+        T *data = m_data;
+        std::memcpy(inline_data(), data, m_count * sizeof(T));
+        array_free(data);
+        m_data = Inline ? inline_data() : nullptr;
+        m_alloc = Inline;
+    } else {
+        reallocate(m_count);
+    }
 }
 
-template<class T>
-T *Array<T>::insert(std::size_t count) {
+template<class T, std::size_t Inline, std::size_t Align>
+T *Array<T, Inline, Align>::insert(std::size_t count) {
     if (count > m_alloc - m_count) {
-        if (count > std::numeric_limits<unsigned>::max() - m_count)
+        if (count > std::numeric_limits<std::size_t>::max() / sizeof(T) -
+            m_count)
             Log::abort("out of memory");
         reserve(count + m_count);
     }
-    int pos = m_count;
+    std::size_t pos = m_count;
     m_count += count;
+    mark_dirty(pos, count);
     return m_data + pos;
 }
 
-template<class T>
-void Array<T>::set_end(T* end) {
-    m_count = static_cast<int>(end - m_data);
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::set_end(T *end) {
+    m_count = static_cast<std::size_t>(end - m_data);
+}
+
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::mark_dirty(std::size_t first,
+                                         std::size_t count) {
+    if (!count)
+        return;
+    if (m_dirty[0] == m_dirty[1]) {
+        m_dirty[0] = first;
+        m_dirty[1] = first + count;
+    } else {
+        if (first < m_dirty[0])
+            m_dirty[0] = first;
+        if (first + count > m_dirty[1])
+            m_dirty[1] = first + count;
+    }
 }
 
-template<class T>
-void Array<T>::upload(GLenum usage) {
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::upload(GLenum usage) {
     glBufferData(GL_ARRAY_BUFFER, m_count * sizeof(T), m_data, usage);
+    m_uploaded = m_count;
+    m_dirty[0] = m_dirty[1] = 0;
+}
+
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::upload_range(std::size_t first,
+                                           std::size_t count) {
+    if (!count)
+        return;
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(T), count * sizeof(T),
+                    m_data + first);
+}
+
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::upload_dirty(GLenum usage) {
+    if (m_count > m_uploaded) {
+        upload(usage);
+        return;
+    }
+    std::size_t end = m_dirty[1] < m_count ? m_dirty[1] : m_count;
+    if (m_dirty[0] < end)
+        upload_range(m_dirty[0], end - m_dirty[0]);
+    m_dirty[0] = m_dirty[1] = 0;
+}
+
+template<class T, std::size_t Inline, std::size_t Align>
+void Array<T, Inline, Align>::reallocate(std::size_t capacity) {
+    if (capacity > std::numeric_limits<std::size_t>::max() / sizeof(T))
+        Log::abort("out of memory");
+    T *data = static_cast<T *>(array_alloc(capacity * sizeof(T), Align));
+    if (m_count)
+        std::memcpy(data, m_data, m_count * sizeof(T));
+    if (!is_inline())
+        array_free(m_data);
+    m_data = data;
+    m_alloc = capacity;
 }
 
 }
@@ -0,0 +1,184 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "bc1.hpp"
+#include "image.hpp"
+#include <cstdint>
+namespace Base {
+
+namespace {
+
+/// Pack an RGB color as 5:6:5.
+unsigned pack565(const float *c) {
+    int r = (int) (c[0] * (31.0f / 255.0f) + 0.5f);
+    int g = (int) (c[1] * (63.0f / 255.0f) + 0.5f);
+    int b = (int) (c[2] * (31.0f / 255.0f) + 0.5f);
+    r = r < 0 ? 0 : r > 31 ? 31 : r;
+    g = g < 0 ? 0 : g > 63 ? 63 : g;
+    b = b < 0 ? 0 : b > 31 ? 31 : b;
+    return (unsigned) ((r << 11) | (g << 5) | b);
+}
+
+/// Unpack a 5:6:5 color to RGB.
+void unpack565(int *c, unsigned v) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+/// Compress one 4x4 block of RGBA pixels.
+void encode_block(unsigned char *out, const unsigned char (*px)[4]) {
+    // Fit the endpoints to the principal axis of the opaque colors.
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    int opaque = 0;
+    bool transparent = false;
+    for (int i = 0; i < 16; i++) {
+        if (px[i][3] < 128) {
+            transparent = true;
+            continue;
+        }
+        for (int j = 0; j < 3; j++)
+            mean[j] += px[i][j];
+        opaque++;
+    }
+
+    unsigned c0 = 0, c1 = 0;
+    if (opaque) {
+        for (int j = 0; j < 3; j++)
+            mean[j] /= (float) opaque;
+        float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++) {
+            if (px[i][3] < 128)
+                continue;
+            float d[3];
+            for (int j = 0; j < 3; j++)
+                d[j] = px[i][j] - mean[j];
+            cov[0] += d[0] * d[0];
+            cov[1] += d[0] * d[1];
+            cov[2] += d[0] * d[2];
+            cov[3] += d[1] * d[1];
+            cov[4] += d[1] * d[2];
+            cov[5] += d[2] * d[2];
+        }
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for (int n = 0; n < 4; n++) {
+            float a[3] = {
+                cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+            };
+            float m = a[0];
+            if (a[1] * a[1] > m * m) m = a[1];
+            if (a[2] * a[2] > m * m) m = a[2];
+            if (m == 0.0f)
+                break;
+            for (int j = 0; j < 3; j++)
+                axis[j] = a[j] / m;
+        }
+        float tmin = +1e9f, tmax = -1e9f;
+        for (int i = 0; i < 16; i++) {
+            if (px[i][3] < 128)
+                continue;
+            float t = 0.0f;
+            for (int j = 0; j < 3; j++)
+                t += (px[i][j] - mean[j]) * axis[j];
+            if (t < tmin) tmin = t;
+            if (t > tmax) tmax = t;
+        }
+        float e0[3], e1[3];
+        for (int j = 0; j < 3; j++) {
+            e0[j] = mean[j] + axis[j] * tmax;
+            e1[j] = mean[j] + axis[j] * tmin;
+        }
+        c0 = pack565(e0);
+        c1 = pack565(e1);
+    }
+
+    // The order of the endpoints selects the mode.  The three-color
+    // mode has a transparent entry, and the four-color mode is only
+    // available if the endpoints differ.
+    bool three = transparent || c0 == c1;
+    if (three ? c0 > c1 : c0 < c1) {
+        unsigned t = c0;
+        c0 = c1;
+        c1 = t;
+    }
+
+    int pal[4][3];
+    unpack565(pal[0], c0);
+    unpack565(pal[1], c1);
+    for (int j = 0; j < 3; j++) {
+        if (three) {
+            pal[2][j] = (pal[0][j] + pal[1][j]) / 2;
+            pal[3][j] = 0;
+        } else {
+            pal[2][j] = (2 * pal[0][j] + pal[1][j]) / 3;
+            pal[3][j] = (pal[0][j] + 2 * pal[1][j]) / 3;
+        }
+    }
+
+    std::uint32_t index = 0;
+    for (int i = 0; i < 16; i++) {
+        unsigned best = 3;
+        if (px[i][3] >= 128) {
+            int best_dist = -1;
+            for (unsigned k = 0; k < (three ? 3u : 4u); k++) {
+                int dist = 0;
+                for (int j = 0; j < 3; j++) {
+                    int d = px[i][j] - pal[k][j];
+                    dist += d * d;
+                }
+                if (best_dist < 0 || dist < best_dist) {
+                    best_dist = dist;
+                    best = k;
+                }
+            }
+        }
+        index |= (std::uint32_t) best << (2 * i);
+    }
+
+    out[0] = (unsigned char) c0;
+    out[1] = (unsigned char) (c0 >> 8);
+    out[2] = (unsigned char) c1;
+    out[3] = (unsigned char) (c1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (unsigned char) (index >> (8 * i));
+}
+
+}
+
+std::size_t bc1_size(int width, int height) {
+    return (std::size_t) ((width + 3) / 4) * ((height + 3) / 4) *
+        BC1_BLOCK_SIZE;
+}
+
+void bc1_encode(std::vector<unsigned char> &out, const Pixbuf &image,
+                int width, int height) {
+    out.resize(bc1_size(width, height));
+    const unsigned char *data =
+        static_cast<const unsigned char *>(image->data);
+    std::size_t rowbytes = image->rowbytes;
+    unsigned char *op = out.data();
+    for (int by = 0; by < height; by += 4) {
+        for (int bx = 0; bx < width; bx += 4) {
+            // Pixels past the edge repeat the last row or column.
+            unsigned char px[16][4];
+            for (int y = 0; y < 4; y++) {
+                int sy = by + y < height ? by + y : height - 1;
+                for (int x = 0; x < 4; x++) {
+                    int sx = bx + x < width ? bx + x : width - 1;
+                    const unsigned char *p =
+                        data + rowbytes * sy + 4 * sx;
+                    for (int j = 0; j < 4; j++)
+                        px[y * 4 + x][j] = p[j];
+                }
+            }
+            encode_block(op, px);
+            op += BC1_BLOCK_SIZE;
+        }
+    }
+}
+
+}
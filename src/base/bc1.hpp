@@ -0,0 +1,25 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_BC1_HPP
+#define LD_BASE_BC1_HPP
+#include <cstddef>
+#include <vector>
+namespace Base {
+class Pixbuf;
+
+/// Size of a BC1 (DXT1) block, in bytes.  Each block holds 4x4 pixels.
+const std::size_t BC1_BLOCK_SIZE = 8;
+
+/// Get the size of a BC1 image, in bytes.
+std::size_t bc1_size(int width, int height);
+
+/// Compress an RGBA image to BC1 with one-bit alpha.  Pixels with
+/// alpha below one half become transparent black.  The blocks are
+/// stored in row-major order, ready for glCompressedTexImage2D.
+void bc1_encode(std::vector<unsigned char> &out, const Pixbuf &image,
+                int width, int height);
+
+}
+#endif
@@ -0,0 +1,116 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "cache.hpp"
+#include "log.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#if defined _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+namespace Base {
+
+namespace {
+
+const std::size_t MAX_SIZE = 1u << 26;
+
+std::string cache_file(const std::string &name) {
+    std::string path = cache_path;
+    path += '/';
+    path += name;
+    return path;
+}
+
+/// Create the cache directory, if it does not already exist.
+bool cache_mkdir() {
+#if defined _WIN32
+    int r = _mkdir(cache_path.c_str());
+#else
+    int r = mkdir(cache_path.c_str(), 0777);
+#endif
+    if (r && errno != EEXIST) {
+        Log::warn("%s: Could not create cache directory: %s",
+                  cache_path.c_str(), std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+}
+
+std::string cache_path("cache");
+
+std::uint64_t hash(const void *data, std::size_t size, std::uint64_t init) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    std::uint64_t h = init;
+    for (std::size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+std::uint64_t hash(const char *str, std::uint64_t init) {
+    if (!str)
+        str = "";
+    return hash(str, std::strlen(str) + 1, init);
+}
+
+bool cache_read(const std::string &name, std::vector<unsigned char> &data) {
+    if (cache_path.empty())
+        return false;
+    std::string path = cache_file(name);
+    std::FILE *fp = std::fopen(path.c_str(), "rb");
+    if (!fp)
+        return false;
+    bool success = false;
+    long size;
+    if (!std::fseek(fp, 0, SEEK_END) &&
+        (size = std::ftell(fp)) >= 0 &&
+        (std::size_t) size <= MAX_SIZE &&
+        !std::fseek(fp, 0, SEEK_SET)) {
+        data.resize((std::size_t) size);
+        success = size == 0 ||
+            std::fread(data.data(), 1, data.size(), fp) == data.size();
+    }
+    std::fclose(fp);
+    if (!success) {
+        Log::warn("%s: Could not read cache file", path.c_str());
+        data.clear();
+    }
+    return success;
+}
+
+bool cache_write(const std::string &name,
+                 const void *data, std::size_t size) {
+    if (cache_path.empty())
+        return false;
+    if (!cache_mkdir())
+        return false;
+    std::string path = cache_file(name), temp = path + ".tmp";
+    std::FILE *fp = std::fopen(temp.c_str(), "wb");
+    if (!fp) {
+        Log::warn("%s: Could not write cache file", temp.c_str());
+        return false;
+    }
+    bool success = std::fwrite(data, 1, size, fp) == size;
+    success = !std::fclose(fp) && success;
+    if (success) {
+#if defined _WIN32
+        std::remove(path.c_str());
+#endif
+        success = !std::rename(temp.c_str(), path.c_str());
+    }
+    if (!success) {
+        Log::warn("%s: Could not write cache file", path.c_str());
+        std::remove(temp.c_str());
+    }
+    return success;
+}
+
+}
@@ -0,0 +1,38 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_CACHE_HPP
+#define LD_BASE_CACHE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+namespace Base {
+
+/// Path to the directory where cached data is stored.  If empty, the
+/// cache is disabled.
+extern std::string cache_path;
+
+/// Initial value for computing hashes.
+const std::uint64_t HASH_INIT = 0xcbf29ce484222325ull;
+
+/// Hash a block of data (64-bit FNV-1a).  Hashes can be chained by
+/// passing the previous result as the initial value.
+std::uint64_t hash(const void *data, std::size_t size,
+                   std::uint64_t init = HASH_INIT);
+
+/// Hash a string, including the terminating NUL byte.
+std::uint64_t hash(const char *str, std::uint64_t init = HASH_INIT);
+
+/// Read a file from the cache.  Returns false if the file does not
+/// exist or the cache is disabled.
+bool cache_read(const std::string &name, std::vector<unsigned char> &data);
+
+/// Write a file to the cache, replacing any existing file.  Returns
+/// false on failure.
+bool cache_write(const std::string &name,
+                 const void *data, std::size_t size);
+
+}
+#endif
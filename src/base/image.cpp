@@ -2,6 +2,7 @@
    This file is part of Legend of Feleria.  Legend of Feleria is
    licensed under the terms of the 2-clause BSD license.  For more
    information, see LICENSE.txt. */
+#include "bc1.hpp"
 #include "file.hpp"
 #include "image.hpp"
 #include "sg/entry.h"
@@ -44,6 +45,22 @@ bool Image::load(const std::string &path) {
     return true;
 }
 
+bool Image::load(const Data &data) {
+    struct sg_error *err = nullptr;
+    sg_image *img = sg_image_buffer(data.ptr(), data.size(), &err);
+    if (!img) {
+        sg_logerrf(SG_LOG_ERROR, err,
+                   "%s: could not load image", data.path());
+        sg_error_clear(&err);
+        return false;
+    }
+    if (m_image) {
+        m_image->free(m_image);
+    }
+    m_image = img;
+    return true;
+}
+
 void Image::draw(Pixbuf &buf, int x, int y) {
     if (!m_image)
         return;
@@ -86,16 +103,64 @@ void Pixbuf::calloc(sg_pixbuf_format_t format, int width, int height) {
         sg_sys_abort("Pixbuf::calloc");
 }
 
+std::size_t Pixbuf::size() const {
+    return m_pixbuf.data ? m_pixbuf.rowbytes * m_pixbuf.height : 0;
+}
+
+TextureData::TextureData()
+    : width(0), height(0)
+{ }
+
+bool TextureData::load(const std::string &path) {
+    Image image;
+    if (!image.load(path))
+        return false;
+    int pwidth = sg_round_up_pow2_32(image->width);
+    int pheight = sg_round_up_pow2_32(image->height);
+    pixbuf.calloc(SG_RGBA, pwidth, pheight);
+    image.draw(pixbuf, 0, 0);
+    width = image->width;
+    height = image->height;
+    return true;
+}
+
+bool TextureData::load(const Data &data) {
+    Image image;
+    if (!image.load(data))
+        return false;
+    int pwidth = sg_round_up_pow2_32(image->width);
+    int pheight = sg_round_up_pow2_32(image->height);
+    pixbuf.calloc(SG_RGBA, pwidth, pheight);
+    image.draw(pixbuf, 0, 0);
+    width = image->width;
+    height = image->height;
+    return true;
+}
+
+bool TextureData::load_1d(const std::string &path) {
+    Image image;
+    if (!image.load(path))
+        return false;
+    int pwidth = sg_round_up_pow2_32(image->width);
+    pixbuf.calloc(SG_RGBA, pwidth, 1);
+    image.draw(pixbuf, 0, 0);
+    width = image->width;
+    height = 1;
+    return true;
+}
+
 Texture::Texture()
     : tex(0),
       iwidth(0), iheight(0),
-      twidth(0), theight(0)
+      twidth(0), theight(0),
+      size(0)
 { }
 
 Texture::Texture(Texture &&other)
     : tex(other.tex),
       iwidth(other.iwidth), iheight(other.iheight),
-      twidth(other.twidth), theight(other.theight) {
+      twidth(other.twidth), theight(other.theight),
+      size(other.size) {
     scale[0] = other.scale[0];
     scale[1] = other.scale[1];
 }
@@ -115,6 +180,7 @@ Texture &Texture::operator=(Texture &&other) {
     iheight  = other.iheight;
     twidth   = other.twidth;
     theight  = other.theight;
+    size     = other.size;
     scale[0] = other.scale[0];
     scale[1] = other.scale[1];
     other.tex = 0;
@@ -122,15 +188,10 @@ Texture &Texture::operator=(Texture &&other) {
 }
 
 bool Texture::load(const std::string &path) {
-    Image image;
-    if (!image.load(path))
+    TextureData data;
+    if (!data.load(path))
         return false;
-    int width = sg_round_up_pow2_32(image->width);
-    int height = sg_round_up_pow2_32(image->height);
-    Pixbuf buf;
-    buf.calloc(SG_RGBA, width, height);
-    image.draw(buf, 0, 0);
-    return load(buf, image->width, image->height);
+    return load(data);
 }
 
 bool Texture::load(const Pixbuf &image, int width, int height) {
@@ -140,6 +201,7 @@ bool Texture::load(const Pixbuf &image, int width, int height) {
     theight = image->height;
     scale[0] = 1.0f / (float) twidth;
     scale[1] = 1.0 / (float) theight;
+    size = image.size();
 
     glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_2D, tex);
@@ -150,15 +212,42 @@ bool Texture::load(const Pixbuf &image, int width, int height) {
     return true;
 }
 
+bool Texture::load(const TextureData &data) {
+    if (!data.pixbuf->data)
+        return false;
+    return load(data.pixbuf, data.width, data.height);
+}
+
+bool Texture::load_bc1(const void *data, std::size_t size,
+                       int width, int height) {
+    if (!GLEW_EXT_texture_compression_s3tc ||
+        size != bc1_size(width, height))
+        return false;
+    iwidth = width;
+    iheight = height;
+    twidth = width;
+    theight = height;
+    scale[0] = 1.0f / (float) twidth;
+    scale[1] = 1.0f / (float) theight;
+    this->size = size;
+
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glCompressedTexImage2D(
+        GL_TEXTURE_2D, 0, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+        width, height, 0, (GLsizei) size, data);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    sg_opengl_checkerror("Texture::load_bc1");
+    return true;
+}
+
 bool Texture::load_1d(const std::string &path) {
-    Image image;
-    if (!image.load(path))
+    TextureData data;
+    if (!data.load_1d(path))
         return false;
-    int width = sg_round_up_pow2_32(image->width);
-    Pixbuf buf;
-    buf.calloc(SG_RGBA, width, 1);
-    image.draw(buf, 0, 0);
-    return load_1d(buf, image->width);
+    return load_1d(data.pixbuf, data.width);
 }
 
 bool Texture::load_1d(const Pixbuf &image, int width) {
@@ -168,6 +257,7 @@ bool Texture::load_1d(const Pixbuf &image, int width) {
     theight = 1;
     scale[0] = (float) (1.0 / twidth);
     scale[1] = 1.0f;
+    size = image.size();
 
     glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_1D, tex);
@@ -6,10 +6,13 @@
 #define LD_BASE_IMAGE_HPP
 #include "sg/opengl.h"
 #include "sg/pixbuf.h"
+#include <cstddef>
 #include <string>
 namespace Base {
+class Data;
 class Pixbuf;
 class Texture;
+struct TextureData;
 
 class Image {
     sg_image *m_image;
@@ -25,6 +28,8 @@ public:
     explicit operator bool() const { return m_image != nullptr; }
 
     bool load(const std::string &path);
+    /// Decode an image file which has already been read.
+    bool load(const Data &data);
     void draw(Pixbuf &buf, int x, int y);
 };
 
@@ -43,6 +48,28 @@ public:
     const sg_pixbuf *operator->() const { return &m_pixbuf; }
     void alloc(sg_pixbuf_format_t format, int width, int height);
     void calloc(sg_pixbuf_format_t format, int width, int height);
+    /// Get the size of the pixel data, in bytes.
+    std::size_t size() const;
+};
+
+/// Image pixels, padded and ready to upload as a texture.  Loading
+/// does not need an OpenGL context, so it can be done on any thread.
+struct TextureData {
+    Pixbuf pixbuf;
+    /// Size of the image, before padding.
+    int width, height;
+
+    TextureData();
+
+    /// Load an image, padded for use as a 2-dimensional texture.
+    bool load(const std::string &path);
+
+    /// Load an image from a file which has already been read, padded
+    /// for use as a 2-dimensional texture.
+    bool load(const Data &data);
+
+    /// Load an image, padded for use as a 1-dimensional texture.
+    bool load_1d(const std::string &path);
 };
 
 class Texture {
@@ -53,6 +80,8 @@ public:
     short twidth;
     short theight;
     float scale[2];
+    /// Estimated size in video memory, in bytes.
+    std::size_t size;
 
     Texture();
     Texture(const Texture &other) = delete;
@@ -67,6 +96,14 @@ public:
     /// Load an image as a 2-dimensional texture.
     bool load(const Pixbuf &image, int width, int height);
 
+    /// Load an image as a 2-dimensional texture.
+    bool load(const TextureData &data);
+
+    /// Load BC1 blocks as a 2-dimensional texture.  Requires
+    /// EXT_texture_compression_s3tc.
+    bool load_bc1(const void *data, std::size_t size,
+                  int width, int height);
+
     /// Load an image as a 1-dimensional texture.
     bool load_1d(const std::string &path);
 
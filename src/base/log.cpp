@@ -3,44 +3,318 @@
    licensed under the terms of the 2-clause BSD license.  For more
    information, see LICENSE.txt. */
 #include "log.hpp"
+#include "cache.hpp"
 #include "sg/log.h"
 #include "sg/entry.h"
-#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 namespace Base {
 
+namespace {
+
+/// Number of messages the queue holds, a power of two.
+const std::size_t QUEUE_SIZE = 1024;
+/// Size of a message which fits in a queue slot.  Longer messages are
+/// copied to the heap.
+const std::size_t MESSAGE_SIZE = 248;
+/// Time between messages from a rate-limited call site.
+const long long LIMIT_INTERVAL_MS = 1000;
+/// How long the writer sleeps when there is nothing to write.
+const int WRITER_SLEEP_MS = 20;
+
+long long now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Bounded queue of formatted messages.  Any thread can push, and
+/// messages are popped under a lock by one writer at a time.  Each
+/// slot has a sequence number which says whether it is free for the
+/// producer claiming that position or full for the consumer.
+class Queue {
+private:
+    struct Slot {
+        std::atomic<std::size_t> seq;
+        sg_log_level_t level;
+        // Full text of a long message, or null.
+        char *heap;
+        char text[MESSAGE_SIZE];
+    };
+
+    Slot m_slot[QUEUE_SIZE];
+    std::atomic<std::size_t> m_head;
+    std::atomic<unsigned> m_dropped;
+    // Consumer state, protected by m_write_lock.
+    std::mutex m_write_lock;
+    std::size_t m_tail;
+    // Wakes the writer.
+    std::mutex m_wake_lock;
+    std::condition_variable m_wake;
+
+public:
+    Queue();
+    Queue(const Queue &) = delete;
+    Queue &operator=(const Queue &) = delete;
+
+    /// Format a message and add it to the queue.  Errors are written
+    /// immediately instead.
+    void push(sg_log_level_t level, LogLimit *limit,
+              const char *msg, va_list ap);
+    /// Write all messages in the queue.
+    void flush();
+
+    /// Get the global queue, creating it and its writer if necessary.
+    static Queue &get();
+
+private:
+    void flush_locked();
+    void writer();
+};
+
+Queue::Queue() : m_head(0), m_dropped(0), m_tail(0) {
+    for (std::size_t i = 0; i < QUEUE_SIZE; i++) {
+        m_slot[i].seq.store(i, std::memory_order_relaxed);
+        m_slot[i].heap = nullptr;
+    }
+    std::thread(&Queue::writer, this).detach();
+}
+
+void Queue::push(sg_log_level_t level, LogLimit *limit,
+                 const char *msg, va_list ap) {
+    char text[MESSAGE_SIZE];
+    va_list ap2;
+    va_copy(ap2, ap);
+    int r = std::vsnprintf(text, MESSAGE_SIZE, msg, ap2);
+    va_end(ap2);
+    std::size_t len = r < 0 ? 0 : (std::size_t) r;
+    if (r < 0)
+        text[0] = '\0';
+
+    char suffix[48];
+    suffix[0] = '\0';
+    if (limit) {
+        unsigned suppressed;
+        if (!limit->allow(hash(text), &suppressed))
+            return;
+        if (suppressed)
+            std::snprintf(suffix, sizeof(suffix),
+                          " (repeated %u times)", suppressed);
+    }
+    std::size_t slen = std::strlen(suffix);
+
+    // Messages too long for a slot, like shader compilation logs, are
+    // formatted again on the heap so they are never cut short.
+    char *heap = nullptr;
+    if (len + slen >= MESSAGE_SIZE) {
+        heap = static_cast<char *>(std::malloc(len + slen + 1));
+        if (heap) {
+            std::vsnprintf(heap, len + 1, msg, ap);
+            std::memcpy(heap + len, suffix, slen + 1);
+        }
+    } else {
+        std::memcpy(text + len, suffix, slen + 1);
+    }
+
+    // Errors often come right before a crash, so write them now.
+    if (level >= SG_LOG_ERROR) {
+        std::lock_guard<std::mutex> lock(m_write_lock);
+        flush_locked();
+        sg_logs(level, heap ? heap : text);
+        std::free(heap);
+        return;
+    }
+
+    std::size_t pos = m_head.load(std::memory_order_relaxed);
+    Slot *slot;
+    while (true) {
+        slot = &m_slot[pos & (QUEUE_SIZE - 1)];
+        std::size_t seq = slot->seq.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = (std::ptrdiff_t) (seq - pos);
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            // The writer has not caught up.
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            std::free(heap);
+            return;
+        } else {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->heap = heap;
+    if (!heap)
+        std::memcpy(slot->text, text, std::strlen(text) + 1);
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    if (level >= SG_LOG_WARN)
+        m_wake.notify_one();
+}
+
+void Queue::flush() {
+    std::lock_guard<std::mutex> lock(m_write_lock);
+    flush_locked();
+}
+
+void Queue::flush_locked() {
+    while (true) {
+        Slot &slot = m_slot[m_tail & (QUEUE_SIZE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != m_tail + 1)
+            break;
+        if (slot.heap) {
+            sg_logs(slot.level, slot.heap);
+            std::free(slot.heap);
+            slot.heap = nullptr;
+        } else {
+            sg_logs(slot.level, slot.text);
+        }
+        slot.seq.store(m_tail + QUEUE_SIZE, std::memory_order_release);
+        m_tail++;
+    }
+    unsigned dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped)
+        sg_logf(SG_LOG_WARN, "Log queue full, %u messages dropped",
+                dropped);
+}
+
+Queue &Queue::get() {
+    // Never destroyed, the writer thread outlives static destructors.
+    static Queue *queue = new Queue;
+    return *queue;
+}
+
+void Queue::writer() {
+    while (true) {
+        flush();
+        std::unique_lock<std::mutex> lock(m_wake_lock);
+        m_wake.wait_for(lock, std::chrono::milliseconds(WRITER_SLEEP_MS));
+    }
+}
+
+}
+
+LogLimit::LogLimit() : m_count(0) { }
+
+bool LogLimit::allow(std::uint64_t key, unsigned *suppressed) {
+    long long now = now_ms();
+    std::lock_guard<std::mutex> lock(m_lock);
+    Entry *e = nullptr;
+    for (int i = 0; i < m_count; i++) {
+        if (m_entry[i].key == key) {
+            e = &m_entry[i];
+            break;
+        }
+    }
+    if (!e) {
+        // Forget the message which was logged longest ago.
+        if (m_count < ENTRY_COUNT) {
+            e = &m_entry[m_count++];
+        } else {
+            e = &m_entry[0];
+            for (int i = 1; i < m_count; i++) {
+                if (m_entry[i].next < e->next)
+                    e = &m_entry[i];
+            }
+        }
+        e->key = key;
+        e->next = 0;
+        e->suppressed = 0;
+    }
+    if (now < e->next) {
+        e->suppressed++;
+        return false;
+    }
+    e->next = now + LIMIT_INTERVAL_MS;
+    *suppressed = e->suppressed;
+    e->suppressed = 0;
+    return true;
+}
+
+void Log::logv(int level, LogLimit *limit, const char *msg, va_list ap) {
+    Queue::get().push((sg_log_level_t) level, limit, msg, ap);
+}
+
+#if LD_LOG_LEVEL <= 0
 void Log::debug(const char *msg, ...) {
     va_list ap;
     va_start(ap, msg);
-    sg_logv(SG_LOG_DEBUG, msg, ap);
+    logv(SG_LOG_DEBUG, nullptr, msg, ap);
+    va_end(ap);
+}
+
+void Log::debug(LogLimit &limit, const char *msg, ...) {
+    va_list ap;
+    va_start(ap, msg);
+    logv(SG_LOG_DEBUG, &limit, msg, ap);
     va_end(ap);
 }
+#endif
 
+#if LD_LOG_LEVEL <= 1
 void Log::info(const char *msg, ...) {
     va_list ap;
     va_start(ap, msg);
-    sg_logv(SG_LOG_INFO, msg, ap);
+    logv(SG_LOG_INFO, nullptr, msg, ap);
+    va_end(ap);
+}
+
+void Log::info(LogLimit &limit, const char *msg, ...) {
+    va_list ap;
+    va_start(ap, msg);
+    logv(SG_LOG_INFO, &limit, msg, ap);
     va_end(ap);
 }
+#endif
 
+#if LD_LOG_LEVEL <= 2
 void Log::warn(const char *msg, ...) {
     va_list ap;
     va_start(ap, msg);
-    sg_logv(SG_LOG_WARN, msg, ap);
+    logv(SG_LOG_WARN, nullptr, msg, ap);
+    va_end(ap);
+}
+
+void Log::warn(LogLimit &limit, const char *msg, ...) {
+    va_list ap;
+    va_start(ap, msg);
+    logv(SG_LOG_WARN, &limit, msg, ap);
     va_end(ap);
 }
+#endif
 
 void Log::error(const char *msg, ...) {
     va_list ap;
     va_start(ap, msg);
-    sg_logv(SG_LOG_ERROR, msg, ap);
+    logv(SG_LOG_ERROR, nullptr, msg, ap);
+    va_end(ap);
+}
+
+void Log::error(LogLimit &limit, const char *msg, ...) {
+    va_list ap;
+    va_start(ap, msg);
+    logv(SG_LOG_ERROR, &limit, msg, ap);
     va_end(ap);
 }
 
 void Log::abort(const char *msg, ...) {
+    flush();
     va_list ap;
     va_start(ap, msg);
     sg_sys_abortv(msg, ap);
     va_end(ap);
 }
 
+void Log::flush() {
+    Queue::get().flush();
+}
+
 }
@@ -5,28 +5,124 @@
 #ifndef LD_BASE_LOG_HPP
 #define LD_BASE_LOG_HPP
 #include "sg/defs.h"
+#include <cstdint>
+#include <mutex>
+#include <stdarg.h>
+
+// Minimum level of messages compiled in: 0 for debug, 1 for info, 2
+// for warnings, 3 for errors.  Build with LD_LOG_LEVEL defined to
+// strip lower levels, which removes the calls entirely.
+#if !defined LD_LOG_LEVEL
+#define LD_LOG_LEVEL 0
+#endif
+
 namespace Base {
 
+/// Limits how often a call site repeats a message.  Messages are
+/// told apart by their text.  Each one is logged the first time, after
+/// that at most once per second, and each logged copy says how many
+/// were suppressed since the last one.  Only the most recent few
+/// messages are remembered.  Declare it static at the call site, and
+/// pass it as the first argument to the Log functions.  Thread safe.
+class LogLimit {
+private:
+    struct Entry {
+        // Hash of the message text.
+        std::uint64_t key;
+        // Time when the next copy is allowed, in milliseconds.
+        long long next;
+        // Number of copies suppressed since the last one logged.
+        unsigned suppressed;
+    };
+
+    static const int ENTRY_COUNT = 8;
+
+    std::mutex m_lock;
+    Entry m_entry[ENTRY_COUNT];
+    int m_count;
+
+public:
+    LogLimit();
+    LogLimit(const LogLimit &) = delete;
+    LogLimit &operator=(const LogLimit &) = delete;
+
+    /// Check whether a message with the given key should be logged.
+    /// If so, store the number of copies suppressed before it.
+    bool allow(std::uint64_t key, unsigned *suppressed);
+};
+
+/// Log messages.  Messages are formatted on the calling thread into a
+/// lock-free queue and written by a background thread, so logging
+/// does not block.  If the queue is full, messages are dropped, and
+/// the number dropped is logged once there is room.  Errors are the
+/// exception: they are written before the call returns, after
+/// everything already queued, and are never dropped.
 struct Log {
+#if LD_LOG_LEVEL <= 0
     /// Log an debug message.
     SG_ATTR_FORMAT(printf, 1, 2)
     static void debug(const char *msg, ...);
+    SG_ATTR_FORMAT(printf, 2, 3)
+    static void debug(LogLimit &limit, const char *msg, ...);
+#else
+    SG_ATTR_FORMAT(printf, 1, 2)
+    static void debug(const char *msg, ...) { (void) msg; }
+    SG_ATTR_FORMAT(printf, 2, 3)
+    static void debug(LogLimit &limit, const char *msg, ...) {
+        (void) limit;
+        (void) msg;
+    }
+#endif
 
+#if LD_LOG_LEVEL <= 1
     /// Log an info message.
     SG_ATTR_FORMAT(printf, 1, 2)
     static void info(const char *msg, ...);
+    SG_ATTR_FORMAT(printf, 2, 3)
+    static void info(LogLimit &limit, const char *msg, ...);
+#else
+    SG_ATTR_FORMAT(printf, 1, 2)
+    static void info(const char *msg, ...) { (void) msg; }
+    SG_ATTR_FORMAT(printf, 2, 3)
+    static void info(LogLimit &limit, const char *msg, ...) {
+        (void) limit;
+        (void) msg;
+    }
+#endif
 
+#if LD_LOG_LEVEL <= 2
     /// Log a warning message.
     SG_ATTR_FORMAT(printf, 1, 2)
     static void warn(const char *msg, ...);
+    SG_ATTR_FORMAT(printf, 2, 3)
+    static void warn(LogLimit &limit, const char *msg, ...);
+#else
+    SG_ATTR_FORMAT(printf, 1, 2)
+    static void warn(const char *msg, ...) { (void) msg; }
+    SG_ATTR_FORMAT(printf, 2, 3)
+    static void warn(LogLimit &limit, const char *msg, ...) {
+        (void) limit;
+        (void) msg;
+    }
+#endif
 
     /// Log an error message.
     SG_ATTR_FORMAT(printf, 1, 2)
     static void error(const char *msg, ...);
+    SG_ATTR_FORMAT(printf, 2, 3)
+    static void error(LogLimit &limit, const char *msg, ...);
 
-    /// Abort with the given message.
+    /// Abort with the given message.  Queued messages are written
+    /// first.
     SG_ATTR_FORMAT(printf, 1, 2)
     static void abort(const char *msg, ...);
+
+    /// Write all queued messages before returning.
+    static void flush();
+
+private:
+    static void logv(int level, LogLimit *limit, const char *msg,
+                     va_list ap);
 };
 
 }
@@ -3,6 +3,11 @@
    licensed under the terms of the 2-clause BSD license.  For more
    information, see LICENSE.txt. */
 #include "mat.hpp"
+#if defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define LD_MAT_SSE2 1
+#include <emmintrin.h>
+#endif
 namespace Base {
 
 /* ======================================================================
@@ -86,6 +91,32 @@ Vec3 Mat4::transform(Vec3 v) const {
     };
 }
 
+// The SSE2 versions add the products in the same order as the scalar
+// versions, so the results are identical.
+
+void Mat4::transform_points(float (*out)[4], const Vec3 *in,
+                            std::size_t count) const {
+#if defined LD_MAT_SSE2
+    const __m128 c0 = _mm_loadu_ps(m[0]), c1 = _mm_loadu_ps(m[1]);
+    const __m128 c2 = _mm_loadu_ps(m[2]), c3 = _mm_loadu_ps(m[3]);
+    for (std::size_t i = 0; i < count; i++) {
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(in[i][0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(in[i][1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(in[i][2])));
+        r = _mm_add_ps(r, c3);
+        _mm_storeu_ps(out[i], r);
+    }
+#else
+    for (std::size_t i = 0; i < count; i++) {
+        Vec3 v = in[i];
+        for (int j = 0; j < 4; j++) {
+            out[i][j] = v[0] * m[0][j] + v[1] * m[1][j] +
+                v[2] * m[2][j] + m[3][j];
+        }
+    }
+#endif
+}
+
 Mat4 Mat4::identity() {
     return Mat4 { {
         { 1.0f, 0.0f, 0.0f, 0.0f },
@@ -155,6 +186,17 @@ Mat4 Mat4::perspective(float mx, float my, float near, float far) {
 
 Mat4 operator*(const Mat4 &x, const Mat4 &y) {
     Mat4 z;
+#if defined LD_MAT_SSE2
+    const __m128 c0 = _mm_loadu_ps(x.m[0]), c1 = _mm_loadu_ps(x.m[1]);
+    const __m128 c2 = _mm_loadu_ps(x.m[2]), c3 = _mm_loadu_ps(x.m[3]);
+    for (int j = 0; j < 4; j++) {
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(y.m[j][0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(y.m[j][1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(y.m[j][2])));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(y.m[j][3])));
+        _mm_storeu_ps(z.m[j], r);
+    }
+#else
     for (int i = 0; i < 4; i++) {
         for (int j = 0; j < 4; j++) {
             z.m[j][i] =
@@ -164,6 +206,7 @@ Mat4 operator*(const Mat4 &x, const Mat4 &y) {
                 x.m[3][i] * y.m[j][3];
         }
     }
+#endif
     return z;
 }
 
@@ -6,6 +6,7 @@
 #define LD_BASE_MAT_HPP
 #include "vec.hpp"
 #include "quat.hpp"
+#include <cstddef>
 namespace Base {
 
 /// Floating-point matrix.
@@ -39,6 +40,10 @@ struct Mat4 {
     const float *data() const { return &m[0][0]; }
     /// Transform a (column) vector using the matrix.
     Vec3 transform(Vec3 v) const;
+    /// Transform an array of points to homogeneous coordinates, with
+    /// w = 1 for the input points.
+    void transform_points(float (*out)[4], const Vec3 *in,
+                          std::size_t count) const;
     /// Create the identity matrix.
     static Mat4 identity();
     /// Create a translation matrix.
@@ -0,0 +1,95 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "memory.hpp"
+#include "file.hpp"
+#include "image.hpp"
+#include "log.hpp"
+#include <cstring>
+namespace Base {
+
+namespace {
+
+const char *const MEM_KIND_NAME[MEM_KIND_COUNT] = {
+    "data", "array", "pixbuf", "vector", "gpu buf", "gpu tex"
+};
+
+double kib(std::size_t bytes) {
+    return (double) bytes * (1.0 / 1024.0);
+}
+
+}
+
+void MemoryReport::add(const char *system, MemKind kind, std::size_t bytes) {
+    Entry *e = nullptr;
+    for (auto &x : m_entry) {
+        if (!std::strcmp(x.system, system)) {
+            e = &x;
+            break;
+        }
+    }
+    if (!e) {
+        m_entry.emplace_back();
+        e = &m_entry.back();
+        e->system = system;
+        for (int i = 0; i < MEM_KIND_COUNT; i++) {
+            e->bytes[i] = 0;
+        }
+    }
+    e->bytes[static_cast<int>(kind)] += bytes;
+}
+
+void MemoryReport::add(const char *system, const Data &data) {
+    add(system, MemKind::DATA, data.size());
+}
+
+void MemoryReport::add(const char *system, const Pixbuf &pixbuf) {
+    add(system, MemKind::PIXBUF, pixbuf.size());
+}
+
+void MemoryReport::add(const char *system, const std::string &str) {
+    add(system, MemKind::VECTOR, str.capacity());
+}
+
+std::size_t MemoryReport::total(const char *system, MemKind kind) const {
+    std::size_t sum = 0;
+    for (const auto &e : m_entry) {
+        if (!system || !std::strcmp(e.system, system)) {
+            sum += e.bytes[static_cast<int>(kind)];
+        }
+    }
+    return sum;
+}
+
+std::size_t MemoryReport::total(const char *system) const {
+    std::size_t sum = 0;
+    for (int i = 0; i < MEM_KIND_COUNT; i++) {
+        sum += total(system, static_cast<MemKind>(i));
+    }
+    return sum;
+}
+
+void MemoryReport::log() const {
+    Log::info("Memory, in KiB:");
+    Log::info("  %-10s %8s %8s %8s %8s %8s %8s %9s", "system",
+              MEM_KIND_NAME[0], MEM_KIND_NAME[1], MEM_KIND_NAME[2],
+              MEM_KIND_NAME[3], MEM_KIND_NAME[4], MEM_KIND_NAME[5],
+              "total");
+    for (const auto &e : m_entry) {
+        Log::info("  %-10s %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %9.1f",
+                  e.system, kib(e.bytes[0]), kib(e.bytes[1]),
+                  kib(e.bytes[2]), kib(e.bytes[3]), kib(e.bytes[4]),
+                  kib(e.bytes[5]), kib(total(e.system)));
+    }
+    Log::info("  %-10s %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f %9.1f", "total",
+              kib(total(nullptr, MemKind::DATA)),
+              kib(total(nullptr, MemKind::ARRAY)),
+              kib(total(nullptr, MemKind::PIXBUF)),
+              kib(total(nullptr, MemKind::VECTOR)),
+              kib(total(nullptr, MemKind::GPU_BUFFER)),
+              kib(total(nullptr, MemKind::GPU_TEXTURE)),
+              kib(total(nullptr)));
+}
+
+}
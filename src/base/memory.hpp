@@ -0,0 +1,78 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_MEMORY_HPP
+#define LD_BASE_MEMORY_HPP
+#include <cstddef>
+#include <string>
+#include <vector>
+namespace Base {
+class Data;
+class Pixbuf;
+template<class T, std::size_t Inline, std::size_t Align> class Array;
+
+/// Kinds of memory in a memory report.
+enum class MemKind {
+    /// File contents, Base::Data.
+    DATA,
+    /// Vertex arrays, Base::Array.
+    ARRAY,
+    /// Images, Base::Pixbuf.
+    PIXBUF,
+    /// Other CPU memory, mostly std::vector storage.
+    VECTOR,
+    /// OpenGL buffer objects (estimated).
+    GPU_BUFFER,
+    /// OpenGL textures (estimated).
+    GPU_TEXTURE
+};
+
+const int MEM_KIND_COUNT = 6;
+
+/// Tally of the memory held by each subsystem, by kind.  Nothing is
+/// counted as memory is allocated.  Instead, each subsystem adds up
+/// what it holds when a report is made, so there is no cost until a
+/// report is requested.
+class MemoryReport {
+private:
+    struct Entry {
+        const char *system;
+        std::size_t bytes[MEM_KIND_COUNT];
+    };
+
+    std::vector<Entry> m_entry;
+
+public:
+    /// Add memory held by a subsystem.
+    void add(const char *system, MemKind kind, std::size_t bytes);
+    /// Add the contents of a file.  Files can be shared, so the same
+    /// file may be counted more than once.
+    void add(const char *system, const Data &data);
+    /// Add the pixels in an image.
+    void add(const char *system, const Pixbuf &pixbuf);
+    /// Add the storage allocated for a vector.
+    template<typename T>
+    void add(const char *system, const std::vector<T> &vec) {
+        add(system, MemKind::VECTOR, vec.capacity() * sizeof(T));
+    }
+    /// Add the storage allocated for an array.
+    template<typename T, std::size_t Inline, std::size_t Align>
+    void add(const char *system, const Array<T, Inline, Align> &array) {
+        add(system, MemKind::ARRAY, array.capacity() * sizeof(T));
+    }
+    /// Add the storage allocated for a string.
+    void add(const char *system, const std::string &str);
+
+    /// Get the memory held by a subsystem, or by all subsystems if
+    /// the name is null.
+    std::size_t total(const char *system, MemKind kind) const;
+    /// Get the total memory held by a subsystem, or by all subsystems
+    /// if the name is null.
+    std::size_t total(const char *system) const;
+    /// Write the report to the log.
+    void log() const;
+};
+
+}
+#endif
@@ -0,0 +1,38 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "radix.hpp"
+namespace Base {
+
+void radix_order(unsigned *order, unsigned *temp,
+                 const std::uint16_t *key, std::size_t count) {
+    std::size_t pos[2][256];
+    for (int i = 0; i < 256; i++) {
+        pos[0][i] = 0;
+        pos[1][i] = 0;
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        pos[0][key[i] & 0xff]++;
+        pos[1][key[i] >> 8]++;
+    }
+    for (int p = 0; p < 2; p++) {
+        std::size_t sum = 0;
+        for (int i = 0; i < 256; i++) {
+            std::size_t n = pos[p][i];
+            pos[p][i] = sum;
+            sum += n;
+        }
+    }
+
+    // Low byte first, then high byte.
+    for (std::size_t i = 0; i < count; i++) {
+        temp[pos[0][key[i] & 0xff]++] = (unsigned) i;
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        unsigned idx = temp[i];
+        order[pos[1][key[idx] >> 8]++] = idx;
+    }
+}
+
+}
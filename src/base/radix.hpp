@@ -0,0 +1,19 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_RADIX_HPP
+#define LD_BASE_RADIX_HPP
+#include <cstddef>
+#include <cstdint>
+namespace Base {
+
+/// Get the order which sorts a list of 16-bit keys, using a radix
+/// sort with two 8-bit passes.  The sort is stable, so items with the
+/// same key keep their original order.  The order and temp arrays
+/// must each have space for count indexes.
+void radix_order(unsigned *order, unsigned *temp,
+                 const std::uint16_t *key, std::size_t count);
+
+}
+#endif
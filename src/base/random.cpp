@@ -4,8 +4,72 @@
    information, see LICENSE.txt. */
 #include "random.hpp"
 #include <limits>
+#if defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define LD_RANDOM_SSE2 1
+#include <emmintrin.h>
+#endif
 namespace Base {
 
+namespace {
+
+// Philox4x32 constants, from Salmon et al., "Parallel Random Numbers:
+// As Easy as 1, 2, 3" (SC11).
+const std::uint32_t PHILOX_M0 = 0xD2511F53u, PHILOX_M1 = 0xCD9E8D57u;
+const std::uint32_t PHILOX_W0 = 0x9E3779B9u, PHILOX_W1 = 0xBB67AE85u;
+const int PHILOX_ROUNDS = 10;
+
+#if defined LD_RANDOM_SSE2
+
+/// Multiply each lane by m, returning the low and high halves.
+void mul32x4(__m128i &lo, __m128i &hi, __m128i x, __m128i m) {
+    const __m128i mask = _mm_set_epi32(0, -1, 0, -1);
+    __m128i even = _mm_mul_epu32(x, m);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), m);
+    lo = _mm_or_si128(_mm_and_si128(even, mask), _mm_slli_epi64(odd, 32));
+    hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(mask, odd));
+}
+
+/// Compute four consecutive blocks, starting at the given counter.
+/// Each vector holds the same word from all four blocks.
+void block4(std::uint32_t *out, const std::uint32_t *key,
+            const std::uint32_t *ctr) {
+    std::uint32_t lo[4], hi[4];
+    for (int i = 0; i < 4; i++) {
+        lo[i] = ctr[0] + i;
+        hi[i] = ctr[1] + (lo[i] < ctr[0]);
+    }
+    __m128i c0 = _mm_set_epi32(lo[3], lo[2], lo[1], lo[0]);
+    __m128i c1 = _mm_set_epi32(hi[3], hi[2], hi[1], hi[0]);
+    __m128i c2 = _mm_set1_epi32(ctr[2]), c3 = _mm_set1_epi32(ctr[3]);
+    std::uint32_t k0 = key[0], k1 = key[1];
+    const __m128i m0 = _mm_set1_epi32(PHILOX_M0);
+    const __m128i m1 = _mm_set1_epi32(PHILOX_M1);
+    for (int r = 0; r < PHILOX_ROUNDS; r++) {
+        __m128i lo0, hi0, lo1, hi1;
+        mul32x4(lo0, hi0, c0, m0);
+        mul32x4(lo1, hi1, c2, m1);
+        c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(k0));
+        c1 = lo1;
+        c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(k1));
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    // Transpose, so each block is contiguous.
+    __m128i t0 = _mm_unpacklo_epi32(c0, c1), t1 = _mm_unpacklo_epi32(c2, c3);
+    __m128i t2 = _mm_unpackhi_epi32(c0, c1), t3 = _mm_unpackhi_epi32(c2, c3);
+    __m128i *p = reinterpret_cast<__m128i *>(out);
+    _mm_storeu_si128(p + 0, _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128(p + 1, _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128(p + 2, _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128(p + 3, _mm_unpackhi_epi64(t2, t3));
+}
+
+#endif
+
+}
+
 Random Random::global = {
     0x20cc842bu,
     0xe2db5f92u,
@@ -31,4 +95,110 @@ int Random::nexti(int max) {
     return x / bin_size;
 }
 
+RandomStream::RandomStream(std::uint64_t seed, std::uint64_t stream) {
+    m_key[0] = (std::uint32_t) seed;
+    m_key[1] = (std::uint32_t) (seed >> 32);
+    m_ctr[0] = 0;
+    m_ctr[1] = 0;
+    m_ctr[2] = (std::uint32_t) stream;
+    m_ctr[3] = (std::uint32_t) (stream >> 32);
+    m_pos = 4;
+}
+
+int RandomStream::nexti(int max) {
+    if (max <= 1)
+        return 0;
+    unsigned bin_size = std::numeric_limits<std::uint32_t>::max() / max;
+    unsigned limit = bin_size * max - 1;
+    unsigned x;
+    do x = next();
+    while (x > limit);
+    return x / bin_size;
+}
+
+void RandomStream::fill(std::uint32_t *out, std::size_t count) {
+    std::size_t i = 0;
+    while (i < count && m_pos < 4)
+        out[i++] = m_buf[m_pos++];
+#if defined LD_RANDOM_SSE2
+    for (; count - i >= 16; i += 16) {
+        block4(out + i, m_key, m_ctr);
+        advance(4);
+    }
+#endif
+    for (; count - i >= 4; i += 4) {
+        block(out + i, m_key, m_ctr);
+        advance(1);
+    }
+    while (i < count)
+        out[i++] = next();
+}
+
+void RandomStream::fillf(float *out, std::size_t count) {
+    // Generate integers in chunks, then convert.
+    const std::size_t CHUNK = 64;
+    std::uint32_t buf[CHUNK];
+    for (std::size_t pos = 0; pos < count; pos += CHUNK) {
+        std::size_t n = count - pos < CHUNK ? count - pos : CHUNK;
+        float *fout = out + pos;
+        fill(buf, n);
+        std::size_t i = 0;
+#if defined LD_RANDOM_SSE2
+        const __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+        for (; n - i >= 4; i += 4) {
+            __m128i x = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(buf + i));
+            __m128 y = _mm_cvtepi32_ps(_mm_srli_epi32(x, 8));
+            _mm_storeu_ps(fout + i, _mm_mul_ps(y, scale));
+        }
+#endif
+        for (; i < n; i++)
+            fout[i] = (float) (buf[i] >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+void RandomStream::seek(std::uint64_t pos) {
+    m_ctr[0] = 0;
+    m_ctr[1] = 0;
+    advance(pos / 4);
+    m_pos = 4;
+    if (pos % 4) {
+        refill();
+        m_pos = (unsigned) (pos % 4);
+    }
+}
+
+void RandomStream::block(std::uint32_t *out, const std::uint32_t *key,
+                         const std::uint32_t *ctr) {
+    std::uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    std::uint32_t k0 = key[0], k1 = key[1];
+    for (int r = 0; r < PHILOX_ROUNDS; r++) {
+        std::uint64_t p0 = (std::uint64_t) PHILOX_M0 * c0;
+        std::uint64_t p1 = (std::uint64_t) PHILOX_M1 * c2;
+        c0 = (std::uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        c1 = (std::uint32_t) p1;
+        c2 = (std::uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c3 = (std::uint32_t) p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+void RandomStream::refill() {
+    block(m_buf, m_key, m_ctr);
+    advance(1);
+    m_pos = 0;
+}
+
+void RandomStream::advance(std::uint64_t blocks) {
+    std::uint64_t pos = ((std::uint64_t) m_ctr[1] << 32) | m_ctr[0];
+    pos += blocks;
+    m_ctr[0] = (std::uint32_t) pos;
+    m_ctr[1] = (std::uint32_t) (pos >> 32);
+}
+
 }
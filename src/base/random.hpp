@@ -4,6 +4,8 @@
    information, see LICENSE.txt. */
 #ifndef LD_BASE_RANDOM_HPP
 #define LD_BASE_RANDOM_HPP
+#include <cstddef>
+#include <cstdint>
 namespace Base {
 
 struct Random {
@@ -57,5 +59,56 @@ struct Random {
     void init();
 };
 
+/// Stream of random numbers from a counter-based generator,
+/// Philox4x32-10.  Each output block is a function of only the seed,
+/// the stream number, and the block's position, so streams are
+/// independent and reproducible no matter which thread uses them or
+/// in which order.  Give each entity or job its own stream number.
+class RandomStream {
+private:
+    std::uint32_t m_key[2];
+    // Counter: position in blocks (low word first), then stream.
+    std::uint32_t m_ctr[4];
+    std::uint32_t m_buf[4];
+    unsigned m_pos;
+
+public:
+    RandomStream(std::uint64_t seed, std::uint64_t stream);
+
+    /// Get the next 32-bit random number.
+    std::uint32_t next() {
+        if (m_pos >= 4)
+            refill();
+        return m_buf[m_pos++];
+    }
+
+    /// Generate x in 0 <= x < max.
+    int nexti(int max);
+
+    /// Generate x in 0 <= x < 1.
+    float nextf() {
+        return (float) (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    /// Fill an array with 32-bit random numbers.  The result is the
+    /// same as calling next() for each element, but faster.
+    void fill(std::uint32_t *out, std::size_t count);
+
+    /// Fill an array with random floats, 0 <= x < 1.  The result is
+    /// the same as calling nextf() for each element, but faster.
+    void fillf(float *out, std::size_t count);
+
+    /// Move to the given position in the stream, counted in numbers.
+    void seek(std::uint64_t pos);
+
+    /// Compute one Philox4x32-10 block.
+    static void block(std::uint32_t *out, const std::uint32_t *key,
+                      const std::uint32_t *ctr);
+
+private:
+    void refill();
+    void advance(std::uint64_t blocks);
+};
+
 }
 #endif
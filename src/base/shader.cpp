@@ -2,14 +2,16 @@
    This file is part of Legend of Feleria.  Legend of Feleria is
    licensed under the terms of the 2-clause BSD license.  For more
    information, see LICENSE.txt. */
+#include "cache.hpp"
 #include "file.hpp"
 #include "shader.hpp"
 #include "log.hpp"
 #include "sg/entry.h"
 #include "sg/shader.h"
-#include <array>
+#include <cstdint>
 #include <cstring>
 #include <stdexcept>
+#include <vector>
 namespace Base {
 
 namespace {
@@ -28,12 +30,25 @@ GLint &get_field(const ShaderField &field, void *object) {
         static_cast<char *>(object) + field.offset);
 }
 
+/// Test whether a uniform is a member of a uniform block.
+bool in_block(GLuint program, const char *name) {
+    if (!GLEW_VERSION_3_1)
+        return false;
+    GLuint index = GL_INVALID_INDEX;
+    glGetUniformIndices(program, 1, &name, &index);
+    if (index == GL_INVALID_INDEX)
+        return false;
+    GLint block = -1;
+    glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block);
+    return block >= 0;
+}
+
 /// Load the indexes of shader uniforms into an object.
 void get_uniforms(const LProgram &program, void *object,
                   const ShaderField *uniforms) {
     for (int i = 0; uniforms[i].name; i++) {
         GLint value = glGetUniformLocation(program.program, uniforms[i].name);
-        if (value < 0) {
+        if (value < 0 && !in_block(program.program, uniforms[i].name)) {
             Log::warn("%s: Uniform does not exist: %s",
                       program.name.c_str(), uniforms[i].name);
         }
@@ -48,6 +63,10 @@ void get_uniforms(const LProgram &program, void *object,
         GLenum type;
         glGetActiveUniform(program.program, j, sizeof(name), nullptr,
                            &size, &type, name);
+        // Every member of a block is active, used or not.
+        if (in_block(program.program, name)) {
+            continue;
+        }
         for (int i = 0; ; i++) {
             if (!uniforms[i].name) {
                 Log::warn("%s: Unbound uniform: %s",
@@ -71,27 +90,58 @@ void get_attributes(const LProgram &program, void *object,
     }
 }
 
-struct ShaderFile {
-    const std::string &path;
-    GLenum type;
-};
+/// Assign binding points to the uniform blocks in a program.
+void bind_blocks(GLuint program, const ShaderBlock *blocks) {
+    if (!GLEW_VERSION_3_1)
+        return;
+    for (int i = 0; blocks[i].name; i++) {
+        GLuint index = glGetUniformBlockIndex(program, blocks[i].name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, blocks[i].binding);
+    }
+}
 
-template<class I>
-LProgram load_program2(I first, I last) {
-    GLenum program;
-    program = glCreateProgram();
+/// Compile a shader from source code.  Returns 0 on failure.
+GLuint compile_shader(const Data &source, GLenum type) {
+    GLuint shader = glCreateShader(type);
+    if (!shader)
+        return 0;
+    const GLchar *text = static_cast<const GLchar *>(source.ptr());
+    GLint length = (GLint) source.size();
+    glShaderSource(shader, 1, &text, &length);
+    glCompileShader(shader);
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLint loglen = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &loglen);
+        std::string log(loglen > 0 ? loglen : 1, '\0');
+        glGetShaderInfoLog(shader, (GLsizei) log.size(), nullptr, &log[0]);
+        Log::error("%s: Compilation failed\n%s",
+                   source.path(), log.c_str());
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+LProgram load_program2(const ProgramSource &source, bool retrievable) {
+    GLuint program = glCreateProgram();
     if (!program)
         return LProgram::none();
-    std::string name;
-    for (I i = first; i != last; ++i) {
-        if (!name.empty())
-            name += ',';
-        name += i->path;
-        std::string path = shader_path;
-        path += '/';
-        path += i->path;
-        GLuint shader = sg_shader_file(
-            path.data(), path.size(), i->type, nullptr);
+    if (retrievable) {
+        glProgramParameteri(
+            program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    const struct {
+        const Data &data;
+        GLenum type;
+    } files[2] = {
+        { source.vertex, GL_VERTEX_SHADER },
+        { source.fragment, GL_FRAGMENT_SHADER }
+    };
+    for (const auto &file : files) {
+        GLuint shader = compile_shader(file.data, file.type);
         if (!shader) {
             glDeleteProgram(program);
             return LProgram::none();
@@ -99,31 +149,224 @@ LProgram load_program2(I first, I last) {
         glAttachShader(program, shader);
         glDeleteShader(shader);
     }
-    int r = sg_shader_link(program, name.c_str(), nullptr);
+    int r = sg_shader_link(program, source.name.c_str(), nullptr);
     if (r) {
         glDeleteProgram(program);
         return LProgram::none();
     }
-    return LProgram { program, std::move(name) };
+    return LProgram { program, source.name };
+}
+
+/* ======================================================================
+   Program binary cache
+   ====================================================================== */
+
+const char BINARY_MAGIC[8] = { 'F', 'e', 'l', 'P', 'r', 'o', 'g', '1' };
+
+/// Header for a cached program binary.  It is followed by the
+/// locations of the uniforms and attributes, then the binary.
+struct BinaryHeader {
+    char magic[8];
+    std::uint64_t key;
+    std::uint32_t format;
+    std::uint32_t field_count;
+    std::uint32_t binary_size;
+    std::uint32_t reserved;
+};
+
+int field_count(const ShaderField *fields) {
+    int n = 0;
+    while (fields[n].name)
+        n++;
+    return n;
+}
+
+/// Test whether the driver can save and restore program binaries.
+bool binary_supported() {
+    if (cache_path.empty() || !GLEW_ARB_get_program_binary)
+        return false;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    return count > 0;
+}
+
+/// Get the cache key for a program.  The key changes whenever the
+/// source code, the field names, or the driver changes.
+std::uint64_t binary_key(const ProgramSource &source,
+                         const ShaderField *uniforms,
+                         const ShaderField *attributes,
+                         const ShaderBlock *blocks) {
+    std::uint64_t h = HASH_INIT;
+    const GLenum strings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : strings) {
+        h = hash(reinterpret_cast<const char *>(glGetString(name)), h);
+    }
+    h = hash(source.vertex.ptr(), source.vertex.size(), h);
+    h = hash(source.fragment.ptr(), source.fragment.size(), h);
+    for (int i = 0; uniforms[i].name; i++)
+        h = hash(uniforms[i].name, h);
+    for (int i = 0; attributes[i].name; i++)
+        h = hash(attributes[i].name, h);
+    for (int i = 0; blocks[i].name; i++)
+        h = hash(blocks[i].name, h);
+    return h;
+}
+
+/// Get the name of the cache file for a program.
+std::string binary_name(const ProgramSource &source) {
+    std::string name = "program-";
+    name += shader_path;
+    name += '-';
+    name += source.name;
+    for (char &c : name) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9') || c == '-';
+        if (!ok)
+            c = '_';
+    }
+    name += ".bin";
+    return name;
+}
+
+/// Load a program from the binary cache.  Returns 0 if the program
+/// is not in the cache or the cached binary is rejected.
+GLuint binary_load(const ProgramSource &source, std::uint64_t key,
+                   const ShaderField *uniforms,
+                   const ShaderField *attributes,
+                   void *object) {
+    std::vector<unsigned char> data;
+    if (!cache_read(binary_name(source), data))
+        return 0;
+
+    int nuniform = field_count(uniforms);
+    int nattribute = field_count(attributes);
+    int nfield = nuniform + nattribute;
+    BinaryHeader head;
+    if (data.size() < sizeof(head))
+        return 0;
+    std::memcpy(&head, data.data(), sizeof(head));
+    std::size_t fieldsize = sizeof(GLint) * nfield;
+    if (std::memcmp(head.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) ||
+        head.key != key ||
+        head.field_count != (std::uint32_t) nfield ||
+        head.binary_size !=
+        data.size() - sizeof(head) - fieldsize) {
+        Log::info("%s: Cached program is out of date",
+                  source.name.c_str());
+        return 0;
+    }
+    const unsigned char *fieldptr = data.data() + sizeof(head);
+
+    GLuint program = glCreateProgram();
+    if (!program)
+        return 0;
+    glProgramBinary(program, head.format,
+                    fieldptr + fieldsize, head.binary_size);
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        // The driver is allowed to reject binaries for any reason.
+        while (glGetError() != GL_NO_ERROR) { }
+        Log::info("%s: Cached program rejected by driver",
+                  source.name.c_str());
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    for (int i = 0; i < nfield; i++) {
+        const ShaderField &field = i < nuniform ?
+            uniforms[i] : attributes[i - nuniform];
+        std::memcpy(&get_field(field, object),
+                    fieldptr + sizeof(GLint) * i, sizeof(GLint));
+    }
+    return program;
+}
+
+/// Save a linked program to the binary cache.
+void binary_save(const ProgramSource &source, std::uint64_t key,
+                 GLuint program,
+                 const ShaderField *uniforms,
+                 const ShaderField *attributes,
+                 void *object) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    int nuniform = field_count(uniforms);
+    int nattribute = field_count(attributes);
+    int nfield = nuniform + nattribute;
+    std::size_t fieldsize = sizeof(GLint) * nfield;
+    std::vector<unsigned char> data(
+        sizeof(BinaryHeader) + fieldsize + length);
+    unsigned char *fieldptr = data.data() + sizeof(BinaryHeader);
+
+    GLenum format = 0;
+    GLsizei actual = 0;
+    glGetProgramBinary(program, length, &actual, &format,
+                       fieldptr + fieldsize);
+    if (actual != length)
+        return;
+
+    BinaryHeader head;
+    std::memcpy(head.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    head.key = key;
+    head.format = format;
+    head.field_count = nfield;
+    head.binary_size = length;
+    head.reserved = 0;
+    std::memcpy(data.data(), &head, sizeof(head));
+    for (int i = 0; i < nfield; i++) {
+        const ShaderField &field = i < nuniform ?
+            uniforms[i] : attributes[i - nuniform];
+        std::memcpy(fieldptr + sizeof(GLint) * i,
+                    &get_field(field, object), sizeof(GLint));
+    }
+
+    cache_write(binary_name(source), data.data(), data.size());
 }
 
 }
 
 std::string shader_path("shader");
 
-GLuint load_program(const std::string &vertexshader,
-                    const std::string &fragmentshader,
+void ProgramSource::read(const std::string &vertexshader,
+                         const std::string &fragmentshader) {
+    const std::size_t MAX_SIZE = 1u << 16;
+    name = vertexshader;
+    name += ',';
+    name += fragmentshader;
+    vertex.read(shader_path + '/' + vertexshader + ".vert", MAX_SIZE);
+    fragment.read(shader_path + '/' + fragmentshader + ".frag", MAX_SIZE);
+}
+
+GLuint load_program(const ProgramSource &source,
                     const ShaderField *uniforms,
                     const ShaderField *attributes,
+                    const ShaderBlock *blocks,
                     void *object) {
-    std::array<ShaderFile, 2> files { {
-        { vertexshader, GL_VERTEX_SHADER },
-        { fragmentshader, GL_FRAGMENT_SHADER }
-    } };
-    LProgram program = load_program2(std::begin(files), std::end(files));
+    bool use_cache = binary_supported();
+    std::uint64_t key = 0;
+    if (use_cache) {
+        key = binary_key(source, uniforms, attributes, blocks);
+        GLuint program = binary_load(
+            source, key, uniforms, attributes, object);
+        if (program) {
+            // Block bindings are reset when a binary is loaded.
+            bind_blocks(program, blocks);
+            return program;
+        }
+    }
+
+    LProgram program = load_program2(source, use_cache);
     if (program.program) {
+        bind_blocks(program.program, blocks);
         get_uniforms(program, object, uniforms);
         get_attributes(program, object, attributes);
+        if (use_cache) {
+            binary_save(source, key, program.program,
+                        uniforms, attributes, object);
+        }
     }
     return program.program;
 }
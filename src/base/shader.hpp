@@ -4,9 +4,11 @@
    information, see LICENSE.txt. */
 #ifndef LD_BASE_SHADER_HPP
 #define LD_BASE_SHADER_HPP
+#include "file.hpp"
 #include "sg/opengl.h"
 #include <cstddef>
 #include <string>
+#include <utility>
 namespace Base {
 
 /// Path to the directory where shaders are located.
@@ -21,14 +23,41 @@ struct ShaderField {
     std::size_t offset;
 };
 
-/// Load an OpenGL shader program.  Returns 0 on failure.
-GLuint load_program(const std::string &vertexshader,
-                    const std::string &fragmentshader,
+/// A uniform block in a program, and the binding point it uses.
+struct ShaderBlock {
+    /// The name of the uniform block.
+    const char *name;
+
+    /// The uniform buffer binding point.
+    GLuint binding;
+};
+
+/// Source code for a shader program.  Reading the source does not
+/// need an OpenGL context, so it can be done on any thread.
+struct ProgramSource {
+    /// Name of the program, for diagnostic messages.
+    std::string name;
+    /// Vertex shader source code.
+    Data vertex;
+    /// Fragment shader source code.
+    Data fragment;
+
+    /// Read the program source code from the shader directory.
+    void read(const std::string &vertexshader,
+              const std::string &fragmentshader);
+};
+
+/// Load an OpenGL shader program.  Returns 0 on failure.  Uniform
+/// blocks which exist in the program are assigned their binding
+/// points.  Uniforms in blocks have no location, and are set to -1.
+GLuint load_program(const ProgramSource &source,
                     const ShaderField *uniforms,
                     const ShaderField *attributes,
+                    const ShaderBlock *blocks,
                     void *object);
 
-/// An OpenGL shader program.  The parameter T has uniforms and attributes.
+/// An OpenGL shader program.  The parameter T has uniforms,
+/// attributes, and uniform blocks.
 template<class T>
 class Program {
 private:
@@ -38,14 +67,13 @@ private:
 public:
     Program();
     Program(const Program &) = delete;
-    Program(const Program &&other);
+    Program(Program &&other);
     ~Program();
     Program &operator=(const Program &) = delete;
     Program &operator=(Program &&other);
 
     /// Load the given shader program.
-    bool load(const std::string &vertexshader,
-              const std::string &fragmentshader);
+    bool load(const ProgramSource &source);
     /// Get program attribute and uniform indexes.
     const T *operator->() const { return &m_fields; }
     /// Get the program object.
@@ -58,7 +86,7 @@ template<class T>
 Program<T>::Program() : m_prog(0) {}
 
 template<class T>
-Program<T>::Program(const Program &&other) {
+Program<T>::Program(Program &&other) : m_prog(0) {
     std::swap(m_prog, other.m_prog);
     m_fields = other.m_fields;
 }
@@ -71,11 +99,10 @@ Program<T> &Program<T>::operator=(Program &&other) {
 }
 
 template<class T>
-bool Program<T>::load(const std::string &vertexshader,
-                      const std::string &fragmentshader) {
+bool Program<T>::load(const ProgramSource &source) {
     GLuint prog = load_program(
-        vertexshader, fragmentshader,
-        T::UNIFORMS, T::ATTRIBUTES,
+        source,
+        T::UNIFORMS, T::ATTRIBUTES, T::BLOCKS,
         &m_fields);
     if (prog == 0) {
         return false;
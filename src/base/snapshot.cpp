@@ -0,0 +1,134 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "snapshot.hpp"
+#include <cstdio>
+#include <cstdlib>
+namespace Base {
+
+namespace {
+
+/// Largest image dimension accepted when reading.
+const int MAX_SIZE = 1 << 14;
+
+/// Read a number from a PPM header, skipping whitespace and comments.
+bool read_number(std::FILE *fp, int *value) {
+    int c = std::fgetc(fp);
+    while (true) {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = std::fgetc(fp);
+            }
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            c = std::fgetc(fp);
+        } else {
+            break;
+        }
+    }
+    if (c < '0' || c > '9') {
+        return false;
+    }
+    int n = 0;
+    while (c >= '0' && c <= '9') {
+        n = n * 10 + (c - '0');
+        if (n > MAX_SIZE) {
+            return false;
+        }
+        c = std::fgetc(fp);
+    }
+    // Exactly one whitespace character follows the number.
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+        return false;
+    }
+    *value = n;
+    return true;
+}
+
+}
+
+Snapshot::Snapshot() : width(0), height(0) { }
+
+void Snapshot::copy_rgba(const void *pixels, std::size_t rowbytes,
+                         int width, int height) {
+    this->width = width;
+    this->height = height;
+    data.resize((std::size_t) width * height * 3);
+    unsigned char *out = data.data();
+    for (int y = 0; y < height; y++) {
+        const unsigned char *in =
+            static_cast<const unsigned char *>(pixels) + rowbytes * y;
+        for (int x = 0; x < width; x++) {
+            out[0] = in[0];
+            out[1] = in[1];
+            out[2] = in[2];
+            out += 3;
+            in += 4;
+        }
+    }
+}
+
+bool Snapshot::read(const std::string &path) {
+    std::FILE *fp = std::fopen(path.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+    int w, h, maxval;
+    bool success =
+        std::fgetc(fp) == 'P' && std::fgetc(fp) == '6' &&
+        read_number(fp, &w) && read_number(fp, &h) &&
+        read_number(fp, &maxval) && maxval == 255;
+    if (success) {
+        width = w;
+        height = h;
+        data.resize((std::size_t) w * h * 3);
+        success = data.empty() ||
+            std::fread(data.data(), 1, data.size(), fp) == data.size();
+    }
+    std::fclose(fp);
+    if (!success) {
+        width = height = 0;
+        data.clear();
+    }
+    return success;
+}
+
+bool Snapshot::write(const std::string &path) const {
+    std::FILE *fp = std::fopen(path.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    bool success = std::fprintf(fp, "P6\n%d %d\n255\n", width, height) > 0;
+    success = success &&
+        std::fwrite(data.data(), 1, data.size(), fp) == data.size();
+    return !std::fclose(fp) && success;
+}
+
+bool snapshot_diff(SnapshotDiff *diff, const Snapshot &a,
+                   const Snapshot &b, int tolerance) {
+    diff->count = 0;
+    diff->max_error = 0;
+    if (a.width != b.width || a.height != b.height) {
+        return false;
+    }
+    const unsigned char *pa = a.data.data(), *pb = b.data.data();
+    std::size_t n = (std::size_t) a.width * a.height;
+    for (std::size_t i = 0; i < n; i++) {
+        int error = 0;
+        for (int j = 0; j < 3; j++) {
+            int e = std::abs((int) pa[i * 3 + j] - (int) pb[i * 3 + j]);
+            if (e > error) {
+                error = e;
+            }
+        }
+        if (error > tolerance) {
+            diff->count++;
+        }
+        if (error > diff->max_error) {
+            diff->max_error = error;
+        }
+    }
+    return true;
+}
+
+}
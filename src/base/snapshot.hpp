@@ -0,0 +1,46 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_SNAPSHOT_HPP
+#define LD_BASE_SNAPSHOT_HPP
+#include <cstddef>
+#include <string>
+#include <vector>
+namespace Base {
+
+/// A copy of a rendered frame, for comparing against a reference
+/// image.  Pixels are RGB, with the top row first and no padding.
+/// Files are binary PPM, which any image viewer can open.
+struct Snapshot {
+    int width, height;
+    std::vector<unsigned char> data;
+
+    Snapshot();
+
+    /// Copy the color channels from an RGBA image.
+    void copy_rgba(const void *pixels, std::size_t rowbytes,
+                   int width, int height);
+    /// Read a binary PPM file.  Returns false if the file could not
+    /// be read or is not an 8-bit binary PPM.
+    bool read(const std::string &path);
+    /// Write a binary PPM file.
+    bool write(const std::string &path) const;
+};
+
+/// The difference between two snapshots.
+struct SnapshotDiff {
+    /// Number of pixels with a channel which differs by more than the
+    /// tolerance.
+    unsigned long count;
+    /// Largest difference in any channel.
+    int max_error;
+};
+
+/// Compare two snapshots.  Returns false if they are not the same
+/// size.
+bool snapshot_diff(SnapshotDiff *diff, const Snapshot &a,
+                   const Snapshot &b, int tolerance);
+
+}
+#endif
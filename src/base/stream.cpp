@@ -0,0 +1,216 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "stream.hpp"
+#include "log.hpp"
+#include <algorithm>
+namespace Base {
+
+namespace {
+
+const std::size_t MIN_SIZE = 1u << 12;
+const GLuint64 FENCE_TIMEOUT = 1000000000u;
+
+std::size_t round_up(std::size_t size) {
+    std::size_t n = MIN_SIZE;
+    while (n < size)
+        n *= 2;
+    return n;
+}
+
+}
+
+StreamBuffer::StreamBuffer()
+    : m_buffer(0),
+      m_persistent(false),
+      m_generation(0),
+      m_size(0),
+      m_pos(0),
+      m_end(0),
+      m_write_pos(0),
+      m_write_stride(0),
+      m_map(nullptr),
+      m_staging(ArrayGrowth::EXACT),
+      m_segment(0) {
+    for (int i = 0; i < SEGMENT_COUNT; i++)
+        m_fence[i] = nullptr;
+}
+
+StreamBuffer::~StreamBuffer() {
+    destroy();
+}
+
+void StreamBuffer::init(std::size_t size) {
+    destroy();
+    m_persistent = GLEW_ARB_buffer_storage != 0;
+    create(round_up(size));
+    Log::info("Stream buffer: %s, %u KiB",
+              m_persistent ? "persistent" : "orphaning",
+              (unsigned) (m_size / 1024));
+}
+
+void StreamBuffer::begin_frame() {
+    collect();
+    if (!m_persistent) {
+        // Orphaning is only safe between frames, when nothing written
+        // to the buffer is still waiting to be drawn.
+        if (m_size - m_pos < m_size / SEGMENT_COUNT) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+            glBufferData(GL_ARRAY_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+            m_pos = 0;
+        }
+        return;
+    }
+    m_segment = (m_segment + 1) % SEGMENT_COUNT;
+    wait_fence(m_segment);
+    std::size_t segsize = m_size / SEGMENT_COUNT;
+    m_pos = segsize * m_segment;
+    m_end = m_pos + segsize;
+}
+
+void StreamBuffer::end_frame() {
+    if (!m_persistent) {
+        // Deletion is deferred by OpenGL until the queued draws finish.
+        for (const auto &r : m_retired)
+            glDeleteBuffers(1, &r.buffer);
+        m_retired.clear();
+        return;
+    }
+    for (auto &r : m_retired) {
+        if (!r.fence)
+            r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    if (m_fence[m_segment])
+        glDeleteSync(m_fence[m_segment]);
+    m_fence[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void *StreamBuffer::reserve(std::size_t count, std::size_t stride) {
+    std::size_t size = count * stride;
+    std::size_t pos = (m_pos + stride - 1) / stride * stride;
+    if (pos + size > m_end) {
+        // Replace the buffer with a larger one.  The old buffer is kept
+        // until the draws which use it are finished, so data committed
+        // earlier in this frame is neither overwritten nor discarded.
+        std::size_t segsize = m_size / SEGMENT_COUNT;
+        retire();
+        create(round_up(std::max(segsize * 2, size + stride)));
+        m_generation++;
+        Log::info("Stream buffer: grew to %u KiB",
+                  (unsigned) (m_size / 1024));
+        pos = 0;
+    }
+    m_write_pos = pos;
+    m_write_stride = stride;
+    if (m_persistent)
+        return m_map + pos;
+    return m_staging.data() + pos;
+}
+
+GLint StreamBuffer::commit(std::size_t count) {
+    std::size_t size = count * m_write_stride;
+    if (!m_persistent && size > 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        m_staging.upload_range(m_write_pos, size);
+    }
+    m_pos = m_write_pos + size;
+    return (GLint) (m_write_pos / m_write_stride);
+}
+
+void StreamBuffer::create(std::size_t segsize) {
+    m_size = segsize * SEGMENT_COUNT;
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    if (m_persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+            GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, m_size, nullptr, flags);
+        m_map = static_cast<unsigned char *>(
+            glMapBufferRange(GL_ARRAY_BUFFER, 0, m_size, flags));
+        if (!m_map)
+            Log::abort("Could not map stream buffer.");
+        m_segment = 0;
+        m_pos = 0;
+        m_end = segsize;
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+        // The staging copy mirrors the buffer, so each commit uploads
+        // just the range it wrote.
+        m_staging.clear();
+        m_staging.resize(m_size);
+        m_pos = 0;
+        m_end = m_size;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    sg_opengl_checkerror("StreamBuffer::create");
+}
+
+void StreamBuffer::destroy() {
+    for (const auto &r : m_retired) {
+        if (r.fence)
+            glDeleteSync(r.fence);
+        glDeleteBuffers(1, &r.buffer);
+    }
+    m_retired.clear();
+    for (int i = 0; i < SEGMENT_COUNT; i++) {
+        if (m_fence[i]) {
+            glDeleteSync(m_fence[i]);
+            m_fence[i] = nullptr;
+        }
+    }
+    if (m_buffer) {
+        // Deleting the buffer also unmaps it.
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+    m_map = nullptr;
+}
+
+void StreamBuffer::retire() {
+    // The segment fences are replaced by one fence for the whole
+    // buffer, created at the end of the frame.
+    for (int i = 0; i < SEGMENT_COUNT; i++) {
+        if (m_fence[i]) {
+            glDeleteSync(m_fence[i]);
+            m_fence[i] = nullptr;
+        }
+    }
+    if (m_buffer)
+        m_retired.push_back(Retired { m_buffer, nullptr });
+    m_buffer = 0;
+    m_map = nullptr;
+}
+
+void StreamBuffer::collect() {
+    std::size_t n = 0;
+    for (const auto &r : m_retired) {
+        bool done = false;
+        if (r.fence) {
+            GLenum status = glClientWaitSync(r.fence, 0, 0);
+            done = status == GL_ALREADY_SIGNALED ||
+                status == GL_CONDITION_SATISFIED;
+        }
+        if (done) {
+            glDeleteSync(r.fence);
+            glDeleteBuffers(1, &r.buffer);
+        } else {
+            m_retired[n++] = r;
+        }
+    }
+    m_retired.resize(n);
+}
+
+void StreamBuffer::wait_fence(int segment) {
+    GLsync fence = m_fence[segment];
+    if (!fence)
+        return;
+    GLenum r = glClientWaitSync(
+        fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+    if (r == GL_TIMEOUT_EXPIRED || r == GL_WAIT_FAILED)
+        Log::warn("Stream buffer fence: wait failed");
+    glDeleteSync(fence);
+    m_fence[segment] = nullptr;
+}
+
+}
@@ -0,0 +1,105 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_STREAM_HPP
+#define LD_BASE_STREAM_HPP
+#include "array.hpp"
+#include "sg/opengl.h"
+#include <cstddef>
+#include <vector>
+namespace Base {
+
+/// OpenGL vertex buffer for data which is rewritten every frame.
+///
+/// Data is written to a ring buffer, so the driver never has to
+/// reallocate storage.  If the context supports ARB_buffer_storage,
+/// the buffer is mapped persistently and split into one segment per
+/// frame in flight, guarded by fences.  Otherwise, data is written to
+/// a CPU copy of the buffer and uploaded with glBufferSubData, and the
+/// buffer is orphaned at the start of a frame when it is nearly full.
+///
+/// If a frame writes more than fits, a larger buffer object replaces
+/// the current one.  The old buffer is kept until the draws using it
+/// have finished, so data committed earlier in the frame stays valid,
+/// but it must be drawn from the buffer object which was current when
+/// it was committed.
+///
+/// Each write is aligned to its stride, so it can be drawn with a
+/// vertex array which points at offset zero, using the index returned
+/// by commit() as the first vertex.
+class StreamBuffer {
+private:
+    static const int SEGMENT_COUNT = 3;
+
+    /// A buffer which was replaced, and is deleted once the GPU is
+    /// done with it.
+    struct Retired {
+        GLuint buffer;
+        GLsync fence;
+    };
+
+    GLuint m_buffer;
+    bool m_persistent;
+    unsigned m_generation;
+    std::size_t m_size;
+    std::size_t m_pos;
+    std::size_t m_end;
+    std::size_t m_write_pos;
+    std::size_t m_write_stride;
+    unsigned char *m_map;
+    Array<unsigned char> m_staging;
+    int m_segment;
+    GLsync m_fence[SEGMENT_COUNT];
+    std::vector<Retired> m_retired;
+
+public:
+    StreamBuffer();
+    StreamBuffer(const StreamBuffer &) = delete;
+    ~StreamBuffer();
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    /// Create the buffer.  The size is the number of bytes written
+    /// per frame, and the buffer grows if necessary.
+    void init(std::size_t size);
+    /// Start writing data for a new frame.
+    void begin_frame();
+    /// Finish writing data for the current frame.
+    void end_frame();
+    /// Reserve space for writing the given number of elements, and
+    /// return a pointer to the space.
+    void *reserve(std::size_t count, std::size_t stride);
+    /// Finish writing data to reserved space.  The count may be less
+    /// than the reserved count.  Returns the index of the first
+    /// element in the buffer.
+    GLint commit(std::size_t count);
+
+    /// Get the buffer object.
+    GLuint buffer() const { return m_buffer; }
+    /// Get the size of the OpenGL buffer, in bytes.
+    std::size_t size() const { return m_size; }
+    /// Get the size of the CPU copy used without persistent mapping,
+    /// in bytes.  It is the same size as the buffer.
+    std::size_t staging_size() const { return m_staging.capacity(); }
+    /// Get the buffer generation.  This changes whenever the buffer
+    /// object changes, and vertex arrays must be set up again.
+    unsigned generation() const { return m_generation; }
+    /// Test whether the buffer is persistently mapped.
+    bool is_persistent() const { return m_persistent; }
+
+    /// Reserve space for writing the given number of objects.
+    template<class T>
+    T *reserve(std::size_t count) {
+        return static_cast<T *>(reserve(count, sizeof(T)));
+    }
+
+private:
+    void create(std::size_t size);
+    void destroy();
+    void retire();
+    void collect();
+    void wait_fence(int segment);
+};
+
+}
+#endif
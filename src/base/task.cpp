@@ -0,0 +1,225 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "task.hpp"
+#include "arena.hpp"
+#include "log.hpp"
+#include <new>
+#include <thread>
+namespace Base {
+
+struct TaskGroup::Task {
+    TaskGroup *group;
+    // Next task in the group.
+    Task *next;
+    // Next task in the pool's queue.
+    Task *queue_next;
+    std::function<void()> func;
+    std::string name;
+    double time;
+};
+
+namespace {
+
+const int MAX_THREADS = 8;
+
+typedef TaskGroup::Task Task;
+
+/// A pool of worker threads which run tasks from a shared queue.  The
+/// queue is a list linked through the tasks, so it never allocates.
+class Pool {
+private:
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    Task *m_head;
+    Task *m_tail;
+    int m_threads;
+
+public:
+    Pool();
+    Pool(const Pool &) = delete;
+    Pool &operator=(const Pool &) = delete;
+
+    /// Add a task to the queue.
+    void push(Task *task);
+    /// Run one task from the given group, if one is queued.
+    bool run_one(const TaskGroup *group);
+    /// Get the number of worker threads.
+    int threads() const { return m_threads; }
+
+    /// Get the global thread pool, creating it if necessary.
+    static Pool &get();
+
+private:
+    void worker();
+};
+
+Pool::Pool() : m_head(nullptr), m_tail(nullptr) {
+    int n = (int) std::thread::hardware_concurrency();
+    if (n < 2)
+        n = 2;
+    if (n > MAX_THREADS)
+        n = MAX_THREADS;
+    m_threads = n;
+    for (int i = 0; i < n; i++) {
+        std::thread(&Pool::worker, this).detach();
+    }
+}
+
+void Pool::push(Task *task) {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        task->queue_next = nullptr;
+        if (m_tail)
+            m_tail->queue_next = task;
+        else
+            m_head = task;
+        m_tail = task;
+    }
+    m_cond.notify_one();
+}
+
+bool Pool::run_one(const TaskGroup *group) {
+    Task *task;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        Task *prev = nullptr;
+        task = m_head;
+        while (task && task->group != group) {
+            prev = task;
+            task = task->queue_next;
+        }
+        if (!task)
+            return false;
+        if (prev)
+            prev->queue_next = task->queue_next;
+        else
+            m_head = task->queue_next;
+        if (m_tail == task)
+            m_tail = prev;
+    }
+    TaskGroup::run(task);
+    return true;
+}
+
+Pool &Pool::get() {
+    // Never destroyed, the worker threads outlive static destructors.
+    static Pool *pool = new Pool;
+    return *pool;
+}
+
+void Pool::worker() {
+    while (true) {
+        Task *task;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_cond.wait(lock, [this] { return m_head != nullptr; });
+            task = m_head;
+            m_head = task->queue_next;
+            if (!m_head)
+                m_tail = nullptr;
+        }
+        TaskGroup::run(task);
+    }
+}
+
+}
+
+TaskGroup::TaskGroup(const std::string &name, bool background)
+    : m_name(name),
+      m_arena(nullptr),
+      m_background(background),
+      m_pending(0),
+      m_first(nullptr),
+      m_last(nullptr) { }
+
+TaskGroup::TaskGroup(Arena &arena)
+    : m_arena(&arena),
+      m_background(false),
+      m_pending(0),
+      m_first(nullptr),
+      m_last(nullptr) { }
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::add(const std::string &name, std::function<void()> func) {
+    void *mem = m_arena ?
+        m_arena->allocate(sizeof(Task), alignof(Task)) :
+        ::operator new(sizeof(Task));
+    Task *task = new (mem) Task;
+    task->group = this;
+    task->next = nullptr;
+    task->func = std::move(func);
+    if (!m_arena)
+        task->name = name;
+    task->time = 0.0;
+    if (m_last)
+        m_last->next = task;
+    else
+        m_first = task;
+    m_last = task;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_pending++;
+    }
+    Pool::get().push(task);
+}
+
+void TaskGroup::run(Task *task) {
+    Timer timer;
+    task->func();
+    task->time = timer.elapsed_ms();
+    TaskGroup &group = *task->group;
+    // Notify with the lock held, since the group may be destroyed as
+    // soon as the lock is released.
+    std::lock_guard<std::mutex> lock(group.m_lock);
+    group.m_pending--;
+    group.m_cond.notify_all();
+}
+
+void TaskGroup::wait() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_pending == 0)
+                break;
+        }
+        // Help out instead of blocking, so waiting from inside a task
+        // cannot deadlock the pool.  Only run this group's tasks, so
+        // the wait never picks up unrelated, long-running work.
+        if (!m_background && Pool::get().run_one(this))
+            continue;
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_cond.wait(lock, [this] { return m_pending == 0; });
+        break;
+    }
+
+    if (!m_first)
+        return;
+    if (!m_arena) {
+        for (Task *t = m_first; t; t = t->next) {
+            Log::info("%s: %s: %.1f ms",
+                      m_name.c_str(), t->name.c_str(), t->time);
+        }
+        Log::info("%s: total: %.1f ms",
+                  m_name.c_str(), m_timer.elapsed_ms());
+    }
+    Task *t = m_first;
+    while (t) {
+        Task *next = t->next;
+        t->~Task();
+        if (!m_arena)
+            ::operator delete(t);
+        t = next;
+    }
+    m_first = m_last = nullptr;
+}
+
+int TaskGroup::thread_count() {
+    return Pool::get().threads();
+}
+
+}
@@ -0,0 +1,66 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_TASK_HPP
+#define LD_BASE_TASK_HPP
+#include "timer.hpp"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+namespace Base {
+class Arena;
+
+/// A group of tasks which run concurrently on the worker thread pool.
+///
+/// Tasks must not touch the OpenGL context, since they run on worker
+/// threads.  When the group is finished, the time spent in each task
+/// is written to the log.
+class TaskGroup {
+public:
+    struct Task;
+
+private:
+    std::string m_name;
+    Arena *m_arena;
+    bool m_background;
+    Timer m_timer;
+    std::mutex m_lock;
+    std::condition_variable m_cond;
+    int m_pending;
+    // Tasks in the order they were added.
+    Task *m_first;
+    Task *m_last;
+
+public:
+    /// Create a task group.  The name is used in the timing report.
+    /// If background is true, the tasks only run on the worker
+    /// threads, and wait() blocks instead of helping, so long jobs
+    /// never run on the thread which waits.
+    explicit TaskGroup(const std::string &name, bool background = false);
+    /// Create a task group for work done every frame.  Tasks are
+    /// allocated from the arena, so the group does not touch the heap
+    /// if the task functions are small.  The group must be used on
+    /// the arena's thread, and destroyed before the arena is reset.
+    /// No timing report is written.
+    explicit TaskGroup(Arena &arena);
+    TaskGroup(const TaskGroup &) = delete;
+    ~TaskGroup();
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    /// Add a task to the group.  The task starts immediately.
+    void add(const std::string &name, std::function<void()> func);
+    /// Wait for all tasks in the group to finish, and log the time
+    /// spent on each task.
+    void wait();
+
+    /// Get the number of worker threads.
+    static int thread_count();
+
+    /// Run a task and mark it finished.  Called by the pool.
+    static void run(Task *task);
+};
+
+}
+#endif
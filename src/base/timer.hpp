@@ -0,0 +1,35 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_BASE_TIMER_HPP
+#define LD_BASE_TIMER_HPP
+#include <chrono>
+namespace Base {
+
+/// Wall clock timer for measuring elapsed time.
+class Timer {
+private:
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point m_start;
+
+public:
+    /// Create a timer, starting now.
+    Timer() : m_start(Clock::now()) { }
+
+    /// Restart the timer.
+    void reset() { m_start = Clock::now(); }
+
+    /// Get the elapsed time, in seconds.
+    double elapsed() const {
+        return std::chrono::duration<double>(Clock::now() - m_start).count();
+    }
+
+    /// Get the elapsed time, in milliseconds.
+    double elapsed_ms() const {
+        return elapsed() * 1000.0;
+    }
+};
+
+}
+#endif
@@ -5,6 +5,8 @@
 #include "game.hpp"
 #include "control.hpp"
 #include "person.hpp"
+#include "base/memory.hpp"
+#include "base/task.hpp"
 namespace Game {
 
 namespace {
@@ -19,16 +21,25 @@ Game::Game()
 Game::~Game() {}
 
 bool Game::load() {
+    bool script_ok = false, sprites_ok = false, world_ok = false;
+    {
+        Base::TaskGroup tasks("Game::load");
+        tasks.add("script", [&] { script_ok = m_script.load(); });
+        tasks.add("sprites", [&] { sprites_ok = m_sprites.load(); });
+        tasks.add("world", [&] { world_ok = m_world.load(); });
+        tasks.wait();
+    }
+
     bool success = true;
-    if (!m_script.load()) {
+    if (!script_ok) {
         Log::warn("Could not load script.");
         success = false;
     }
-    if (!m_sprites.load()) {
+    if (!sprites_ok) {
         Log::warn("Could not load sprites.");
         success = false;
     }
-    if (!m_world.load()) {
+    if (!world_ok) {
         Log::warn("Could not load world.");
         success = false;
     }
@@ -90,4 +101,12 @@ void Game::advance() {
     }
 }
 
+void Game::report_memory(Base::MemoryReport &report) const {
+    m_script.report_memory(report);
+    m_machine.report_memory(report);
+    m_sprites.report_memory(report);
+    m_world.report_memory(report);
+    report.add("people", m_person);
+}
+
 }
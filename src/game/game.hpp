@@ -88,6 +88,11 @@ public:
         return m_sprites;
     }
 
+    /// Get the sprite data.
+    SpriteData &sprites() {
+        return m_sprites;
+    }
+
     /// Get the game world.
     const World &world() const {
         return m_world;
@@ -112,6 +117,9 @@ public:
         return m_person;
     }
 
+    /// Add the memory used by the game state to a report.
+    void report_memory(Base::MemoryReport &report) const;
+
 private:
     void advance();
 };
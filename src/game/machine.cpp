@@ -6,7 +6,10 @@
 #include "script.hpp"
 #include "game.hpp"
 #include "person.hpp"
+#include "base/arena.hpp"
+#include "base/memory.hpp"
 #include "sg/mixer.h"
+#include <algorithm>
 namespace Game {
 
 namespace {
@@ -214,7 +217,8 @@ void Machine::run(Game &game) {
     ProgReader r(m_script, m_pc);
     while (!r.is_halted()) {
         if (icount++ >= MACHINE_SPEED) {
-            Log::warn("Instruction limit hit... infinite loop?");
+            static Base::LogLimit limit;
+            Log::warn(limit, "Instruction limit hit... infinite loop?");
             break;
         }
 
@@ -293,7 +297,7 @@ void Machine::run(Game &game) {
             const char *name = m_script.get_text(i);
             if (name) {
                 if (name != m_trackname) {
-                    std::string path("music/");
+                    Base::FrameString path("music/");
                     path += name;
                     m_trackname = name;
                     static sg_mixer_channel *chan;
@@ -417,6 +421,24 @@ exit:
     }
 }
 
+std::vector<const char *> Machine::dialog_text() const {
+    std::vector<const char *> result;
+    auto prog = m_script.program();
+    int vsay = opcode_val(Opcode::SAY);
+    int vresp = opcode_val(Opcode::RESPONSE);
+    // Operands never have the high bit set, so they can't be mistaken
+    // for opcodes.
+    for (auto p = prog.begin(), e = prog.end(); p != e && p + 1 != e; p++) {
+        if ((*p != vsay && *p != vresp) || (p[1] & 0x8000) != 0)
+            continue;
+        const char *text = m_script.get_text(p[1]);
+        if (text != nullptr &&
+            std::find(result.begin(), result.end(), text) == result.end())
+            result.push_back(text);
+    }
+    return result;
+}
+
 void Machine::trigger_script(int character) {
     if (m_pc != -1) {
         return;
@@ -444,4 +466,10 @@ int Machine::get_var(int var) const {
     return m_memory[var];
 }
 
+void Machine::report_memory(Base::MemoryReport &report) const {
+    report.add("script", m_memory);
+    report.add("script", m_text);
+    report.add("script", m_trackname);
+}
+
 }
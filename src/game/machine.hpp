@@ -7,6 +7,9 @@
 #include <vector>
 #include <string>
 struct sg_sound;
+namespace Base {
+class MemoryReport;
+}
 namespace Game {
 class Script;
 class Game;
@@ -60,6 +63,12 @@ public:
         return m_text;
     }
 
+    // Get every line of text that SAY or RESPONSE can show.
+    std::vector<const char *> dialog_text() const;
+
+    /// Add the memory used to a report.
+    void report_memory(Base::MemoryReport &report) const;
+
 private:
     void set_var(int var, int value);
 
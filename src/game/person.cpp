@@ -52,6 +52,9 @@ const Part PART_ORDER[4][PART_COUNT] = {
 };
 #undef PARTS_BODY
 
+// The most recently assigned appearance number.
+unsigned appearance_counter;
+
 }
 
 Person::Person(int identity, Vec2 pos, Direction dir) {
@@ -61,6 +64,9 @@ Person::Person(int identity, Vec2 pos, Direction dir) {
     for (int i = 0; i < PART_COUNT; i++)
         m_part[i] = -1;
     m_spritecount = 0;
+    m_parts_changed = true;
+    m_sprite_key = 0;
+    m_appearance = 0;
     m_pos[0] = m_pos[1] = pos;
     m_posz[0] = m_posz[1] = 0.0f;
     m_vel = Vec2::zero();
@@ -73,6 +79,14 @@ void Person::initialize(Game &game) {
     m_posz[0] = m_posz[1] = game.world().height_at(m_pos[0]) + HEIGHT * 0.5f;
 }
 
+void Person::set_part(Part part, int sprite) {
+    int index = static_cast<int>(part);
+    if (m_part[index] != sprite) {
+        m_part[index] = sprite;
+        m_parts_changed = true;
+    }
+}
+
 void Person::update(Game &game) {
     float dtime = game.frame_delta();
     Vec2 in_move;
@@ -133,64 +147,63 @@ void Person::update(Game &game) {
     m_posz[1] = game.world().height_at(m_pos[1]) + HEIGHT * 0.5f;
     m_vel = v1;
 
-    // Update sprites
+    // Advance the walking animation.
+    int walkframe;
     {
-        // The offsets are always initialized by the walking code.
-        short offsets[PART_COUNT];
-        short frames[GROUP_COUNT];
-        for (int i = 0; i < GROUP_COUNT; i++) {
-            frames[i] = 0;
-        }
-
-        // Handle walking animation.
-        {
-            Vec2 step = m_pos[1] - m_steppos;
-            float stepd2 = step.mag2();
-            WalkFrame walk;
-            if (stepd2 >= STEP_DISTANCE * STEP_DISTANCE) {
-                float stepd = std::sqrt(stepd2);
-                float nstep = stepd / STEP_DISTANCE;
-                m_steppos += step *
-                    (std::floor(nstep) * STEP_DISTANCE / stepd);
-                m_stepframe = (m_stepframe + (int) nstep) % WALK_COUNT;
-                walk = WALK_FRAME[m_stepframe];
-                m_standtime = STAND_TIME;
-                m_dir = direction_from_vec(step);
+        Vec2 step = m_pos[1] - m_steppos;
+        float stepd2 = step.mag2();
+        if (stepd2 >= STEP_DISTANCE * STEP_DISTANCE) {
+            float stepd = std::sqrt(stepd2);
+            float nstep = stepd / STEP_DISTANCE;
+            m_steppos += step *
+                (std::floor(nstep) * STEP_DISTANCE / stepd);
+            m_stepframe = (m_stepframe + (int) nstep) % WALK_COUNT;
+            walkframe = m_stepframe;
+            m_standtime = STAND_TIME;
+            m_dir = direction_from_vec(step);
+        } else {
+            m_standtime -= dtime;
+            if (m_standtime > 0.0f) {
+                walkframe = m_stepframe;
             } else {
-                m_standtime -= dtime;
-                if (m_standtime > 0.0f) {
-                    walk = WALK_FRAME[m_stepframe];
-                } else {
-                    m_standtime = 0.0f;
-                    walk = WALK_FRAME[WALK_STAND];
-                }
+                m_standtime = 0.0f;
+                walkframe = WALK_STAND;
             }
+        }
+    }
 
-            frames[static_cast<int>(Group::LEGS)] = walk.legs_frame;
-            frames[static_cast<int>(Group::TORSO)] = walk.torso_frame;
-            for (int i = 0; i < PART_COUNT; i++) {
-                offsets[i] = walk.yoff;
-            }
-            offsets[static_cast<int>(Part::BOTTOM)] = 0;
+    // Update sprites, only if the appearance changed.
+    unsigned key = (unsigned) m_dir * (WALK_COUNT + 1) + walkframe;
+    if (m_parts_changed || key != m_sprite_key) {
+        m_parts_changed = false;
+        m_sprite_key = key;
+        if (!++appearance_counter) {
+            appearance_counter = 1;
         }
+        m_appearance = appearance_counter;
 
-        // Render parts to the sprite array.
-        {
-            int pos = 0, d = static_cast<int>(m_dir);
-            for (int i = 0; i < PART_COUNT; i++) {
-                int part = static_cast<int>(PART_ORDER[d][i]);
-                int sprite = m_part[part];
-                if (sprite < 0)
-                    continue;
-                Group group = PART_GROUP[part];
-                m_sprite[pos++] = PartSprite::create(
-                    sprite,
-                    frames[static_cast<int>(group)],
-                    0,
-                    offsets[part]);
-            }
-            m_spritecount = pos;
+        const WalkFrame &walk = WALK_FRAME[walkframe];
+        short frames[GROUP_COUNT];
+        for (int i = 0; i < GROUP_COUNT; i++) {
+            frames[i] = 0;
+        }
+        frames[static_cast<int>(Group::LEGS)] = walk.legs_frame;
+        frames[static_cast<int>(Group::TORSO)] = walk.torso_frame;
+
+        int pos = 0, d = static_cast<int>(m_dir);
+        for (int i = 0; i < PART_COUNT; i++) {
+            int part = static_cast<int>(PART_ORDER[d][i]);
+            int sprite = m_part[part];
+            if (sprite < 0)
+                continue;
+            Group group = PART_GROUP[part];
+            m_sprite[pos++] = PartSprite::create(
+                sprite,
+                frames[static_cast<int>(group)],
+                0,
+                part == static_cast<int>(Part::BOTTOM) ? 0 : walk.yoff);
         }
+        m_spritecount = pos;
     }
 }
 
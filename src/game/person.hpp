@@ -87,9 +87,16 @@ private:
     // Sprites for each part of the person.
     int m_part[PART_COUNT];
 
-    // Expanded version of the sprites, recalculated each update.
+    // Expanded version of the sprites, recalculated when the parts,
+    // direction, or walking frame change.
     PartSprite m_sprite[PART_COUNT];
     int m_spritecount;
+    // Whether m_part changed since the sprites were expanded.
+    bool m_parts_changed;
+    // The direction and walking frame of the expanded sprites.
+    unsigned m_sprite_key;
+    // Number identifying the current appearance.
+    unsigned m_appearance;
 
     // Current and previous position.
     Vec2 m_pos[2];
@@ -125,9 +132,7 @@ public:
     // ============================================================
 
     /// Set the apperance of a part of the person.
-    void set_part(Part part, int sprite) {
-        m_part[static_cast<int>(part)] = sprite;
-    }
+    void set_part(Part part, int sprite);
 
     void set_player(bool is_player) {
         m_is_player = is_player;
@@ -155,6 +160,14 @@ public:
         }};
     }
 
+    /// Get a number identifying the person's current sprites.  The
+    /// number changes whenever the sprites change, and numbers are
+    /// never shared by different people, so it can be used as a
+    /// cache key.  Zero means the person has no sprites yet.
+    unsigned appearance() const {
+        return m_appearance;
+    }
+
     // Get the person's sprites.
     Base::Range<PartSprite> sprite() const {
         return Base::Range<PartSprite>(
@@ -4,6 +4,7 @@
    information, see LICENSE.txt. */
 #include "script.hpp"
 #include "base/chunk.hpp"
+#include "base/memory.hpp"
 #include <cstring>
 #include "defs.hpp"
 namespace Game {
@@ -60,10 +61,15 @@ int Script::get_label(const std::string &name) const {
 
 const char *Script::get_text(int index) const {
     if (index < 0 || (std::size_t) index >= m_text.size() - 1) {
-        Log::error("Invalid text index: %d", index);
+        static Base::LogLimit limit;
+        Log::error(limit, "Invalid text index: %d", index);
         return nullptr;
     }
     return &m_text[index];
 }
 
+void Script::report_memory(Base::MemoryReport &report) const {
+    report.add("script", m_data);
+}
+
 }
@@ -6,6 +6,9 @@
 #define LD_GAME_SCRIPT_HPP
 #include "base/file.hpp"
 #include "base/range.hpp"
+namespace Base {
+class MemoryReport;
+}
 namespace Game {
 
 class Script {
@@ -40,6 +43,9 @@ public:
     int memory_size() const {
         return m_varname.size();
     }
+
+    /// Add the memory used to a report.
+    void report_memory(Base::MemoryReport &report) const;
 };
 
 }
@@ -6,6 +6,7 @@
 #include "sprite.hpp"
 #include "sg/sprite.h"
 #include "base/chunk.hpp"
+#include "base/memory.hpp"
 #include <cstring>
 namespace Game {
 
@@ -51,19 +52,18 @@ bool SpriteData::load() {
         const auto ifo = chunk_gifo[i];
         g.w = ifo.w;
         g.h = ifo.h;
-        if (ifo.w == 0 || ifo.h == 0) {
-            g.sprites = nullptr;
-        } else {
+        g.offset = ifo.offset;
+        if (ifo.w != 0 && ifo.h != 0) {
             std::size_t n = (std::size_t) ifo.w * ifo.h;
             if (ifo.offset > scount || n > scount - ifo.offset) {
                 return false;
             }
-            g.sprites = &chunk_sprt[ifo.offset];
         }
     }
 
     m_data = std::move(data);
     m_groupinfo = std::move(ginfo);
+    m_sprite.assign(chunk_sprt.begin(), chunk_sprt.end());
     m_groupname = chunk_gnam;
     return true;
 }
@@ -75,7 +75,8 @@ int SpriteData::get_index(const char *name) const {
             return (int) i;
         }
     }
-    Log::warn("Missing sprite: %s", name);
+    static Base::LogLimit limit;
+    Log::warn(limit, "Missing sprite: %s", name);
     return -1;
 }
 
@@ -87,7 +88,21 @@ const struct sg_sprite &SpriteData::get_data(
     const auto &ifo = m_groupinfo[sprite];
     if (nx < 0 || nx >= ifo.w || ny < 0 || ny >= ifo.h)
         return ZERO_SPRITE;
-    return ifo.sprites[ny * ifo.w + nx];
+    return m_sprite[ifo.offset + ny * ifo.w + nx];
+}
+
+void SpriteData::set_rects(std::vector<sg_sprite> rects) {
+    if (rects.size() != m_sprite.size()) {
+        Log::error("Sprite count mismatch");
+        return;
+    }
+    m_sprite = std::move(rects);
+}
+
+void SpriteData::report_memory(Base::MemoryReport &report) const {
+    report.add("sprites", m_data);
+    report.add("sprites", m_groupinfo);
+    report.add("sprites", m_sprite);
 }
 
 }
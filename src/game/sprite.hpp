@@ -6,8 +6,11 @@
 #define LD_GAME_SPRITE_HPP
 #include "base/file.hpp"
 #include "base/range.hpp"
+#include "sg/sprite.h"
 #include <vector>
-struct sg_sprite;
+namespace Base {
+class MemoryReport;
+}
 namespace Game {
 
 /// Information about all sprites in the assets.
@@ -15,11 +18,12 @@ class SpriteData {
 private:
     struct GroupInfo {
         int w, h;
-        const sg_sprite *sprites;
+        std::size_t offset;
     };
 
     Base::Data m_data;
     std::vector<GroupInfo> m_groupinfo;
+    std::vector<sg_sprite> m_sprite;
     Base::Range<char[16]> m_groupname;
 
 public:
@@ -39,6 +43,19 @@ public:
 
     /// Get sprite data.
     const struct sg_sprite &get_data(int sprite, int nx, int ny) const;
+
+    /// Get the data for every sprite.  The rectangles are in the
+    /// sprite sheet until they are moved by set_rects().
+    const std::vector<sg_sprite> &rects() const {
+        return m_sprite;
+    }
+
+    /// Replace the data for every sprite, after the sprites are moved
+    /// to a different texture.
+    void set_rects(std::vector<sg_sprite> rects);
+
+    /// Add the memory used to a report.
+    void report_memory(Base::MemoryReport &report) const;
 };
 
 }
@@ -4,6 +4,7 @@
    information, see LICENSE.txt. */
 #include "world.hpp"
 #include "base/chunk.hpp"
+#include "base/memory.hpp"
 #include <cstring>
 namespace Game {
 
@@ -262,4 +263,8 @@ World::EdgeTrace World::edge_distance(Vec2 pos, bool is_player) const {
     return is_inside ? best : EdgeTrace(-best.first, -best.second);
 }
 
+void World::report_memory(Base::MemoryReport &report) const {
+    report.add("world", m_data);
+}
+
 }
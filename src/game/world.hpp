@@ -7,6 +7,9 @@
 #include "base/file.hpp"
 #include "defs.hpp"
 #include <utility>
+namespace Base {
+class MemoryReport;
+}
 namespace Game {
 
 /// Information about the world (the terrain, not the objects in it).
@@ -61,6 +64,14 @@ public:
     /// Get the terrain height at the given position.
     float height_at(Vec2 pos) const;
 
+    /// Get the terrain height at a heightmap cell, which must be
+    /// inside the map.  Unlike height_at(), this works for the last
+    /// row and column.
+    float height_cell(int x, int y) const {
+        return m_heightmap[y * m_size[0] + x] * m_height_scale +
+            m_height_min;
+    }
+
     /// Project a 2D point onto the terrain.
     Vec3 project(Vec2 pos) const {
         return Vec3 {{ pos[0], pos[1], height_at(pos) }};
@@ -71,6 +82,9 @@ public:
     /// we are outside.  If the magnitude of the distance is large,
     /// then the distance and direction are bogus.
     EdgeTrace edge_distance(Vec2 pos, bool is_player) const;
+
+    /// Add the memory used to a report.
+    void report_memory(Base::MemoryReport &report) const;
 };
 
 }
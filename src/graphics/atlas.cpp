@@ -0,0 +1,124 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "atlas.hpp"
+#include "base/image.hpp"
+#include <algorithm>
+#include <cstring>
+namespace Graphics {
+
+namespace {
+
+/// A horizontal segment of the top edge of the packed area.
+struct Segment {
+    int x, y, w;
+};
+
+/// Get the lowest position where a rectangle of the given width can
+/// start at the given segment.  Returns -1 if it does not fit.
+int fit(const std::vector<Segment> &sky, std::size_t i, int w, int width) {
+    if (sky[i].x + w > width)
+        return -1;
+    int y = 0;
+    for (int rem = w; rem > 0; i++) {
+        y = std::max(y, sky[i].y);
+        rem -= sky[i].w;
+    }
+    return y;
+}
+
+}
+
+int atlas_width(const std::vector<AtlasRect> &rects, int padding) {
+    double area = 0.0;
+    int maxw = 1;
+    for (const auto &r : rects) {
+        area += (double) (r.w + padding) * (r.h + padding);
+        maxw = std::max(maxw, r.w + padding);
+    }
+    int width = 64;
+    while (width < maxw || (double) width * width < area)
+        width *= 2;
+    return width;
+}
+
+int pack_atlas(std::vector<AtlasRect> &rects, int width, int padding) {
+    // Place tall rectangles first.
+    std::vector<std::size_t> order(rects.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(
+        order.begin(), order.end(),
+        [&rects](std::size_t a, std::size_t b) {
+            if (rects[a].h != rects[b].h)
+                return rects[a].h > rects[b].h;
+            return rects[a].w > rects[b].w;
+        });
+
+    std::vector<Segment> sky;
+    sky.push_back(Segment { 0, 0, width });
+    int height = 0;
+    for (std::size_t n : order) {
+        AtlasRect &r = rects[n];
+        int w = r.w + padding, h = r.h + padding;
+        std::size_t best = (std::size_t) -1;
+        int besty = 0;
+        for (std::size_t i = 0; i < sky.size(); i++) {
+            int y = fit(sky, i, w, width);
+            // The skyline is sorted, so ties go to the leftmost.
+            if (y >= 0 && (best == (std::size_t) -1 || y < besty)) {
+                best = i;
+                besty = y;
+            }
+        }
+        if (best == (std::size_t) -1) {
+            // Wider than the atlas, this is a bug in the caller.
+            r.x = 0;
+            r.y = height;
+            height += h;
+            continue;
+        }
+        r.x = sky[best].x;
+        r.y = besty;
+        height = std::max(height, besty + h);
+
+        // Replace the covered part of the skyline with the new top.
+        Segment top { r.x, besty + h, w };
+        std::size_t i = best;
+        int end = r.x + w;
+        while (i < sky.size() && sky[i].x + sky[i].w <= end)
+            sky.erase(sky.begin() + i);
+        if (i < sky.size() && sky[i].x < end) {
+            sky[i].w -= end - sky[i].x;
+            sky[i].x = end;
+        }
+        sky.insert(sky.begin() + i, top);
+
+        // Merge segments at the same height.
+        for (std::size_t j = 0; j + 1 < sky.size(); ) {
+            if (sky[j].y == sky[j + 1].y) {
+                sky[j].w += sky[j + 1].w;
+                sky.erase(sky.begin() + j + 1);
+            } else {
+                j++;
+            }
+        }
+    }
+    return height;
+}
+
+void copy_pixels(Base::Pixbuf &dest, int dx, int dy,
+                 const Base::Pixbuf &src, int sx, int sy, int w, int h) {
+    const std::size_t pixsize = 4;
+    unsigned char *dptr = static_cast<unsigned char *>(dest->data);
+    const unsigned char *sptr = static_cast<const unsigned char *>(src->data);
+    for (int y = 0; y < h; y++) {
+        std::memcpy(
+            dptr + (dy + y) * dest->rowbytes + dx * pixsize,
+            sptr + (sy + y) * src->rowbytes + sx * pixsize,
+            w * pixsize);
+    }
+}
+
+}
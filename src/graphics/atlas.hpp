@@ -0,0 +1,36 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_ATLAS_HPP
+#define LD_GRAPHICS_ATLAS_HPP
+#include <vector>
+namespace Base {
+class Pixbuf;
+}
+namespace Graphics {
+
+/// A rectangle in a texture atlas.
+struct AtlasRect {
+    /// Size of the rectangle, in pixels.
+    int w, h;
+    /// Position of the rectangle in the atlas, set by pack_atlas().
+    int x, y;
+};
+
+/// Choose a width for an atlas containing the given rectangles.  The
+/// width is a power of two, and the atlas will be roughly square.
+int atlas_width(const std::vector<AtlasRect> &rects, int padding);
+
+/// Pack rectangles into an atlas with the given width, using the
+/// skyline bottom-left heuristic.  Each rectangle is followed by the
+/// given amount of empty space on the right and bottom.  Returns the
+/// height of the atlas.
+int pack_atlas(std::vector<AtlasRect> &rects, int width, int padding);
+
+/// Copy a rectangle of pixels between RGBA pixel buffers.
+void copy_pixels(Base::Pixbuf &dest, int dx, int dy,
+                 const Base::Pixbuf &src, int sx, int sy, int w, int h);
+
+}
+#endif
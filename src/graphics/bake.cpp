@@ -0,0 +1,255 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "bake.hpp"
+#include <algorithm>
+#include <cmath>
+#if defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define LD_BAKE_SSE2 1
+#include <emmintrin.h>
+#endif
+namespace Graphics {
+
+namespace {
+
+const float LIGHT_DIR[TERRAIN_LIGHT_COUNT][3] = {
+    { 0.0f, 0.0f, 1.0f },
+    { 0.0f, 1.0f, 0.0f },
+    { 1.0f, 0.0f, 0.0f },
+    {-1.0f, 0.0f, 0.0f }
+};
+const float LIGHT_COLOR[TERRAIN_LIGHT_COUNT][3] = {
+    { 0.5f, 0.5f, 0.5f },
+    { 1.0f, 0.5f, 0.5f },
+    { 0.5f, 1.0f, 0.5f },
+    { 0.5f, 0.5f, 1.0f }
+};
+
+/// Per-terrain constants for the color blend.
+struct Blend {
+    float c1[3], c2[3];
+    float edge, inv_width;
+};
+
+void make_blend(Blend blend[4], const TerrainLighting &lighting) {
+    for (int i = 0; i < 4; i++) {
+        const Color &a = lighting.terrain_color[i * 2];
+        const Color &b = lighting.terrain_color[i * 2 + 1];
+        for (int j = 0; j < 3; j++) {
+            blend[i].c1[j] = a.v[j];
+            blend[i].c2[j] = b.v[j];
+        }
+        blend[i].edge = a.v[3];
+        float width = b.v[3] - a.v[3];
+        // When the edges are equal, this becomes a step function.
+        blend[i].inv_width = width > 0.0f ? 1.0f / width : 1e30f;
+    }
+}
+
+/// Get a signed 10-bit field.
+int field10(std::uint32_t v, int shift) {
+    return (std::int32_t) (v << (22 - shift)) >> 22;
+}
+
+unsigned char to_byte(float x) {
+    return (unsigned char) (std::max(0.0f, std::min(1.0f, x)) * 255.0f + 0.5f);
+}
+
+void bake_scalar(BakedVertex *out, const std::uint64_t *vertex,
+                 std::size_t count, const TerrainLighting &lighting,
+                 const Blend blend[4]) {
+    for (std::size_t i = 0; i < count; i++) {
+        std::uint32_t pos = (std::uint32_t) vertex[i];
+        std::uint32_t nrm = (std::uint32_t) (vertex[i] >> 32);
+        // The operations are in the same order as the SSE2 code, so
+        // both give the same bytes.
+        float n[3];
+        for (int j = 0; j < 3; j++) {
+            n[j] = std::max(
+                (float) field10(nrm, j * 10) * (1.0f / 511.0f), -1.0f);
+        }
+        float len2 = (n[0] * n[0] + n[1] * n[1]) + n[2] * n[2];
+        float inv = 1.0f / std::sqrt(std::max(len2, 1e-12f));
+        for (int j = 0; j < 3; j++)
+            n[j] *= inv;
+        float light[3] = { 0.0f, 0.0f, 0.0f };
+        for (int k = 0; k < lighting.light_count; k++) {
+            const float *d = lighting.light_dir[k];
+            const float *c = lighting.light_color[k];
+            float x = std::max(
+                0.0f, n[0] * d[0] + n[1] * d[1] + n[2] * d[2]);
+            for (int j = 0; j < 3; j++)
+                light[j] += x * c[j];
+        }
+
+        const Blend &b = blend[((std::int32_t) pos >> 30) + 2];
+        float t = ((float) field10(pos, 20) - b.edge) * b.inv_width;
+        t = std::max(0.0f, std::min(1.0f, t));
+        t = t * t * (3.0f - 2.0f * t);
+
+        BakedVertex &v = out[i];
+        v.pos = pos;
+        for (int j = 0; j < 3; j++) {
+            v.color[j] = to_byte(b.c1[j] + (b.c2[j] - b.c1[j]) * t);
+            v.light[j] = to_byte(light[j] * (1.0f / BAKED_LIGHT_SCALE));
+        }
+        v.color[3] = 255;
+        v.light[3] = 255;
+    }
+}
+
+#if defined LD_BAKE_SSE2
+
+/// Get four signed 10-bit fields as floats.
+__m128 field10x4(__m128i v, int shift) {
+    return _mm_cvtepi32_ps(
+        _mm_srai_epi32(_mm_sll_epi32(v, _mm_cvtsi32_si128(22 - shift)), 22));
+}
+
+/// Convert four RGB colors in [0, 1] to packed RGBA bytes.
+__m128i pack_rgba(__m128 r, __m128 g, __m128 b) {
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+    __m128i ri = _mm_cvttps_epi32(_mm_add_ps(
+        _mm_mul_ps(_mm_min_ps(_mm_max_ps(r, zero), one), scale), half));
+    __m128i gi = _mm_cvttps_epi32(_mm_add_ps(
+        _mm_mul_ps(_mm_min_ps(_mm_max_ps(g, zero), one), scale), half));
+    __m128i bi = _mm_cvttps_epi32(_mm_add_ps(
+        _mm_mul_ps(_mm_min_ps(_mm_max_ps(b, zero), one), scale), half));
+    return _mm_or_si128(
+        _mm_or_si128(ri, _mm_slli_epi32(gi, 8)),
+        _mm_or_si128(_mm_slli_epi32(bi, 16),
+                     _mm_set1_epi32((int) 0xff000000u)));
+}
+
+/// Bake four vertexes at a time.  Returns the number of vertexes
+/// baked, the rest are left for the scalar code.
+std::size_t bake_sse2(BakedVertex *out, const std::uint64_t *vertex,
+                      std::size_t count, const TerrainLighting &lighting,
+                      const Blend blend[4]) {
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128 inv_scale = _mm_set1_ps(1.0f / BAKED_LIGHT_SCALE);
+    std::size_t n = count & ~(std::size_t) 3;
+    for (std::size_t i = 0; i < n; i += 4) {
+        std::uint32_t pos[4], nrm[4];
+        for (int j = 0; j < 4; j++) {
+            pos[j] = (std::uint32_t) vertex[i + j];
+            nrm[j] = (std::uint32_t) (vertex[i + j] >> 32);
+        }
+        __m128i vpos = _mm_loadu_si128(reinterpret_cast<__m128i *>(pos));
+        __m128i vnrm = _mm_loadu_si128(reinterpret_cast<__m128i *>(nrm));
+
+        // Normalize the normals.
+        const __m128 nscale = _mm_set1_ps(1.0f / 511.0f);
+        const __m128 mone = _mm_set1_ps(-1.0f);
+        __m128 nx = _mm_max_ps(_mm_mul_ps(field10x4(vnrm, 0), nscale), mone);
+        __m128 ny = _mm_max_ps(_mm_mul_ps(field10x4(vnrm, 10), nscale), mone);
+        __m128 nz = _mm_max_ps(_mm_mul_ps(field10x4(vnrm, 20), nscale), mone);
+        __m128 len2 = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)),
+            _mm_mul_ps(nz, nz));
+        __m128 inv = _mm_div_ps(
+            one, _mm_sqrt_ps(_mm_max_ps(len2, _mm_set1_ps(1e-12f))));
+        nx = _mm_mul_ps(nx, inv);
+        ny = _mm_mul_ps(ny, inv);
+        nz = _mm_mul_ps(nz, inv);
+
+        __m128 lr = zero, lg = zero, lb = zero;
+        for (int k = 0; k < lighting.light_count; k++) {
+            const float *d = lighting.light_dir[k];
+            const float *c = lighting.light_color[k];
+            __m128 x = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(d[0])),
+                           _mm_mul_ps(ny, _mm_set1_ps(d[1]))),
+                _mm_mul_ps(nz, _mm_set1_ps(d[2])));
+            x = _mm_max_ps(x, zero);
+            lr = _mm_add_ps(lr, _mm_mul_ps(x, _mm_set1_ps(c[0])));
+            lg = _mm_add_ps(lg, _mm_mul_ps(x, _mm_set1_ps(c[1])));
+            lb = _mm_add_ps(lb, _mm_mul_ps(x, _mm_set1_ps(c[2])));
+        }
+
+        // Gather the blend constants for each vertex's terrain type.
+        const Blend *b[4];
+        for (int j = 0; j < 4; j++)
+            b[j] = &blend[((std::int32_t) pos[j] >> 30) + 2];
+        __m128 edge = _mm_setr_ps(
+            b[0]->edge, b[1]->edge, b[2]->edge, b[3]->edge);
+        __m128 iw = _mm_setr_ps(
+            b[0]->inv_width, b[1]->inv_width,
+            b[2]->inv_width, b[3]->inv_width);
+        __m128 t = _mm_mul_ps(_mm_sub_ps(field10x4(vpos, 20), edge), iw);
+        t = _mm_min_ps(_mm_max_ps(t, zero), one);
+        t = _mm_mul_ps(_mm_mul_ps(t, t),
+                       _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(t, t)));
+        __m128 c[3];
+        for (int j = 0; j < 3; j++) {
+            __m128 c1 = _mm_setr_ps(
+                b[0]->c1[j], b[1]->c1[j], b[2]->c1[j], b[3]->c1[j]);
+            __m128 c2 = _mm_setr_ps(
+                b[0]->c2[j], b[1]->c2[j], b[2]->c2[j], b[3]->c2[j]);
+            c[j] = _mm_add_ps(c1, _mm_mul_ps(_mm_sub_ps(c2, c1), t));
+        }
+
+        std::uint32_t color[4], light[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(color),
+                         pack_rgba(c[0], c[1], c[2]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(light),
+                         pack_rgba(_mm_mul_ps(lr, inv_scale),
+                                   _mm_mul_ps(lg, inv_scale),
+                                   _mm_mul_ps(lb, inv_scale)));
+        for (int j = 0; j < 4; j++) {
+            BakedVertex &v = out[i + j];
+            v.pos = pos[j];
+            for (int k = 0; k < 4; k++) {
+                v.color[k] = (unsigned char) (color[j] >> (k * 8));
+                v.light[k] = (unsigned char) (light[j] >> (k * 8));
+            }
+        }
+    }
+    return n;
+}
+
+#endif
+
+}
+
+TerrainLighting terrain_lighting(Vec3 scale) {
+    TerrainLighting t = {
+        {
+            Color::palette(1),  Color::palette(2),
+            Color::palette(7), Color::palette(20),
+            Color::palette(3),  Color::palette(3),
+            Color::palette(27),  Color::palette(27)
+        },
+        TERRAIN_LIGHT_COUNT,
+        LIGHT_DIR,
+        LIGHT_COLOR
+    };
+    const float height[8] = {
+        -5.0f, +8.0f, 2.5f, 7.0f,
+        -100.0f, -100.0f, -100.0f, -100.0f
+    };
+    for (int i = 0; i < 8; i++) {
+        t.terrain_color[i].v[3] = height[i] * (1.0f / scale[2]);
+    }
+    return t;
+}
+
+void bake_terrain(std::vector<BakedVertex> &out,
+                  const std::vector<std::uint64_t> &vertex,
+                  const TerrainLighting &lighting) {
+    Blend blend[4];
+    make_blend(blend, lighting);
+    out.resize(vertex.size());
+    std::size_t done = 0;
+#if defined LD_BAKE_SSE2
+    done = bake_sse2(out.data(), vertex.data(), vertex.size(),
+                     lighting, blend);
+#endif
+    bake_scalar(out.data() + done, vertex.data() + done,
+                vertex.size() - done, lighting, blend);
+}
+
+}
@@ -0,0 +1,53 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_BAKE_HPP
+#define LD_GRAPHICS_BAKE_HPP
+#include "defs.hpp"
+#include "color.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+namespace Graphics {
+
+/// Lighting is stored divided by this scale, since the sum of all
+/// lights can be brighter than 1.  The "world_baked" shader must use
+/// the same scale.
+const float BAKED_LIGHT_SCALE = 2.0f;
+
+/// Terrain vertex with precomputed color and lighting, 12 bytes.
+struct BakedVertex {
+    /// Position, GL_INT_2_10_10_10_REV, copied from the mesh.
+    std::uint32_t pos;
+    /// Terrain color, RGBA.
+    unsigned char color[4];
+    /// Light, RGBA, divided by BAKED_LIGHT_SCALE.
+    unsigned char light[4];
+};
+
+/// Number of directional lights on the terrain.
+const int TERRAIN_LIGHT_COUNT = 4;
+
+/// Static terrain colors and directional lights.
+struct TerrainLighting {
+    /// Pairs of colors for each terrain type.  The alpha channel is
+    /// the height, in vertex coordinates, where each color is used.
+    Color terrain_color[8];
+    int light_count;
+    const float (*light_dir)[3];
+    const float (*light_color)[3];
+};
+
+/// Get the terrain colors and lights, for vertexes with the given
+/// scale.
+TerrainLighting terrain_lighting(Vec3 scale);
+
+/// Calculate the color and lighting for 8-byte mesh vertexes, doing
+/// the same work as the "world" vertex shader.
+void bake_terrain(std::vector<BakedVertex> &out,
+                  const std::vector<std::uint64_t> &vertex,
+                  const TerrainLighting &lighting);
+
+}
+#endif
@@ -0,0 +1,36 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "frustum.hpp"
+namespace Graphics {
+
+Frustum Frustum::from_matrix(const Base::Mat4 &mvp) {
+    // Gribb and Hartmann: each plane is the last row of the matrix
+    // plus or minus one of the other rows.
+    Frustum f;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            f.plane[i*2+0][j] = mvp.m[j][3] + mvp.m[j][i];
+            f.plane[i*2+1][j] = mvp.m[j][3] - mvp.m[j][i];
+        }
+    }
+    return f;
+}
+
+bool Frustum::test(const Base::IBox3 &box) const {
+    for (int i = 0; i < PLANE_COUNT; i++) {
+        const float *p = plane[i];
+        // Test the corner furthest along the plane's normal.
+        float d = p[3];
+        for (int j = 0; j < 3; j++) {
+            d += p[j] * (float) (p[j] >= 0.0f ? box.maxs[j] : box.mins[j]);
+        }
+        if (d < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,30 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_FRUSTUM_HPP
+#define LD_GRAPHICS_FRUSTUM_HPP
+#include "base/ibox.hpp"
+#include "base/mat.hpp"
+namespace Graphics {
+
+/// View frustum, for culling geometry which is not visible.  This
+/// does not depend on OpenGL.
+struct Frustum {
+    static const int PLANE_COUNT = 6;
+
+    /// Clipping planes (a, b, c, d).  A point is inside a plane if
+    /// ax + by + cz + d >= 0.
+    float plane[PLANE_COUNT][4];
+
+    /// Get the frustum for a combined model, view, and projection
+    /// matrix.  The frustum is in model coordinates.
+    static Frustum from_matrix(const Base::Mat4 &mvp);
+    /// Test whether any part of a box might be visible.  This is
+    /// conservative, and may return true for boxes outside the
+    /// frustum near its corners.
+    bool test(const Base::IBox3 &box) const;
+};
+
+}
+#endif
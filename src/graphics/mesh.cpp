@@ -0,0 +1,328 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "defs.hpp"
+#include "mesh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+namespace Graphics {
+
+namespace {
+
+const int CACHE_SLOTS = VERTEX_CACHE_SIZE + 3;
+
+/// Score a vertex for the Forsyth algorithm.
+float vertex_score(int cache_pos, unsigned remaining) {
+    if (!remaining)
+        return -1.0f;
+    float score = 0.0f;
+    if (cache_pos >= 0) {
+        if (cache_pos < 3) {
+            // The last triangle's vertexes get a fixed score, so the
+            // next triangle doesn't simply reuse the same edge.
+            score = 0.75f;
+        } else {
+            float x = 1.0f - (float) (cache_pos - 3) *
+                (1.0f / (float) (VERTEX_CACHE_SIZE - 3));
+            score = std::pow(x, 1.5f);
+        }
+    }
+    // Prefer vertexes with few triangles left, so they can retire.
+    score += 2.0f / std::sqrt((float) remaining);
+    return score;
+}
+
+/// Get the tile containing a triangle.
+Base::IVec2 triangle_tile(const Mesh &m, const unsigned *tri) {
+    Base::IVec3 sum = Base::IVec3::zero();
+    for (int i = 0; i < 3; i++)
+        sum = sum + vertex_position(m.vertex[tri[i]]);
+    Base::IVec2 t;
+    for (int i = 0; i < 2; i++) {
+        // Bias so division rounds down, coordinates are 10 bits.
+        int x = sum[i] + 3 * (1 << 10);
+        t[i] = x / (3 * MESH_TILE_SIZE);
+    }
+    return t;
+}
+
+}
+
+Mesh::Mesh()
+    : level_count(1)
+{ }
+
+void Mesh::build(const void *data, std::size_t size) {
+    std::size_t count = size / 8;
+    count -= count % 3;
+    if (count * 8 != size)
+        Log::warn("Mesh: ignoring %u trailing bytes",
+                  (unsigned) (size - count * 8));
+    vertex.clear();
+    index.clear();
+    index.reserve(count);
+    level_count = 1;
+
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        std::unordered_map<std::uint64_t, unsigned> map;
+        map.reserve(count / 2);
+        for (std::size_t i = 0; i < count; i++) {
+            std::uint64_t v;
+            std::memcpy(&v, p + i * 8, 8);
+            auto r = map.insert(std::make_pair(v, (unsigned) vertex.size()));
+            if (r.second)
+                vertex.push_back(v);
+            index.push_back(r.first->second);
+        }
+    }
+
+    double acmr0 = cache_miss_ratio(index.data(), index.size(),
+                                    vertex.size());
+
+    // Sort triangles by tile, keeping the original order within
+    // each tile.
+    tile.clear();
+    {
+        std::size_t tricount = count / 3;
+        std::vector<std::pair<std::uint32_t, unsigned>> order(tricount);
+        for (std::size_t i = 0; i < tricount; i++) {
+            auto t = triangle_tile(*this, &index[i * 3]);
+            order[i] = std::make_pair(
+                ((std::uint32_t) t[1] << 16) | (std::uint32_t) t[0],
+                (unsigned) i);
+        }
+        std::sort(order.begin(), order.end());
+        std::vector<unsigned> sorted(tricount * 3);
+        for (std::size_t i = 0; i < tricount; i++) {
+            for (int j = 0; j < 3; j++)
+                sorted[i * 3 + j] = index[order[i].second * 3 + j];
+        }
+        index.swap(sorted);
+
+        // Tiles are optimized with local vertex numbers, so the
+        // optimizer's tables are only as large as the tile.
+        std::vector<unsigned> local(vertex.size(), (unsigned) -1);
+        std::vector<unsigned> global;
+
+        for (std::size_t i = 0; i < tricount; ) {
+            std::size_t j = i + 1;
+            while (j < tricount && order[j].first == order[i].first)
+                j++;
+            MeshTile mt;
+            mt.first = (unsigned) (i * 3);
+            mt.count = (unsigned) ((j - i) * 3);
+            auto p = vertex_position(vertex[index[mt.first]]);
+            mt.bounds.mins = p;
+            mt.bounds.maxs = p;
+            for (unsigned k = 0; k < mt.count; k++) {
+                auto q = vertex_position(vertex[index[mt.first + k]]);
+                for (int n = 0; n < 3; n++) {
+                    mt.bounds.mins[n] = std::min(mt.bounds.mins[n], q[n]);
+                    mt.bounds.maxs[n] = std::max(mt.bounds.maxs[n], q[n]);
+                }
+            }
+            // Boxes are half-open.
+            for (int n = 0; n < 3; n++)
+                mt.bounds.maxs[n]++;
+            unsigned *tidx = &index[mt.first];
+            global.clear();
+            for (unsigned k = 0; k < mt.count; k++) {
+                unsigned &v = local[tidx[k]];
+                if (v == (unsigned) -1) {
+                    v = (unsigned) global.size();
+                    global.push_back(tidx[k]);
+                }
+                tidx[k] = v;
+            }
+            optimize_triangles(tidx, mt.count, global.size());
+            for (unsigned k = 0; k < mt.count; k++)
+                tidx[k] = global[tidx[k]];
+            for (unsigned v : global)
+                local[v] = (unsigned) -1;
+            tile.push_back(mt);
+            i = j;
+        }
+    }
+
+    double acmr1 = cache_miss_ratio(index.data(), index.size(),
+                                    vertex.size());
+    Log::info("Mesh: %u triangles, %u -> %u vertexes, ACMR %.3f -> %.3f",
+              (unsigned) (count / 3), (unsigned) count,
+              (unsigned) vertex.size(), acmr0, acmr1);
+    Log::info("Mesh: %u tiles", (unsigned) tile.size());
+}
+
+GLenum Mesh::index_type() const {
+    return vertex.size() <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+std::size_t Mesh::index_size() const {
+    return vertex.size() <= 0x10000 ? 2 : 4;
+}
+
+void Mesh::upload_vertex() const {
+    glBufferData(GL_ARRAY_BUFFER, vertex.size() * 8,
+                 vertex.data(), GL_STATIC_DRAW);
+}
+
+void Mesh::upload_index() const {
+    if (index_type() == GL_UNSIGNED_INT) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     index.size() * sizeof(unsigned),
+                     index.data(), GL_STATIC_DRAW);
+    } else {
+        std::vector<unsigned short> index16(index.begin(), index.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     index16.size() * sizeof(unsigned short),
+                     index16.data(), GL_STATIC_DRAW);
+    }
+}
+
+Base::IVec3 vertex_position(std::uint64_t vertex) {
+    // GL_INT_2_10_10_10_REV, the first four bytes.
+    std::uint32_t v = (std::uint32_t) vertex;
+    Base::IVec3 p;
+    for (int i = 0; i < 3; i++) {
+        std::int32_t x = (std::int32_t) (v << (22 - 10 * i));
+        p[i] = x >> 22;
+    }
+    return p;
+}
+
+void optimize_triangles(unsigned *index, std::size_t count,
+                        std::size_t vertcount) {
+    std::size_t tricount = count / 3;
+    if (tricount < 2)
+        return;
+
+    // Triangles using each vertex.  The live triangles for vertex v
+    // are vtri[vstart[v]] .. vtri[vstart[v] + vremain[v] - 1].
+    std::vector<unsigned> vstart(vertcount + 1, 0), vremain(vertcount, 0);
+    std::vector<unsigned> vtri(tricount * 3);
+    for (std::size_t i = 0; i < tricount * 3; i++)
+        vremain[index[i]]++;
+    for (std::size_t v = 0; v < vertcount; v++)
+        vstart[v + 1] = vstart[v] + vremain[v];
+    {
+        std::vector<unsigned> fill(vstart.begin(), vstart.end() - 1);
+        for (std::size_t i = 0; i < tricount * 3; i++)
+            vtri[fill[index[i]]++] = (unsigned) (i / 3);
+    }
+
+    std::vector<int> vcache(vertcount, -1);
+    std::vector<float> vscore(vertcount);
+    for (std::size_t v = 0; v < vertcount; v++)
+        vscore[v] = vertex_score(-1, vremain[v]);
+
+    std::vector<float> tscore(tricount);
+    std::vector<bool> tdone(tricount, false);
+    for (std::size_t t = 0; t < tricount; t++) {
+        tscore[t] = vscore[index[t*3+0]] + vscore[index[t*3+1]] +
+            vscore[index[t*3+2]];
+    }
+
+    std::vector<unsigned> out;
+    out.reserve(tricount * 3);
+    int cache[CACHE_SLOTS], cache_count = 0;
+    std::size_t cursor = 0;
+    long best = -1;
+
+    for (std::size_t n = 0; n < tricount; n++) {
+        if (best < 0) {
+            // Nothing in the cache, restart with the best remaining
+            // triangle near the cursor.
+            while (tdone[cursor])
+                cursor++;
+            best = (long) cursor;
+            for (std::size_t t = cursor, e = std::min(tricount, cursor + 64);
+                 t < e; t++) {
+                if (!tdone[t] && tscore[t] > tscore[best])
+                    best = (long) t;
+            }
+        }
+
+        unsigned t = (unsigned) best;
+        const unsigned *tv = index + t * 3;
+        tdone[t] = true;
+        for (int i = 0; i < 3; i++) {
+            unsigned v = tv[i];
+            out.push_back(v);
+            unsigned *list = vtri.data() + vstart[v];
+            unsigned live = vremain[v];
+            for (unsigned j = 0; j < live; j++) {
+                if (list[j] == t) {
+                    list[j] = list[live - 1];
+                    break;
+                }
+            }
+            vremain[v] = live - 1;
+        }
+
+        // Move the triangle's vertexes to the front of the cache.
+        int newcache[CACHE_SLOTS + 3], newcount = 0;
+        for (int i = 0; i < 3; i++)
+            newcache[newcount++] = (int) tv[i];
+        for (int i = 0; i < cache_count; i++) {
+            int v = cache[i];
+            if (v != (int) tv[0] && v != (int) tv[1] && v != (int) tv[2])
+                newcache[newcount++] = v;
+        }
+        for (int i = CACHE_SLOTS; i < newcount; i++)
+            vcache[newcache[i]] = -1;
+        cache_count = std::min(newcount, CACHE_SLOTS);
+        for (int i = 0; i < cache_count; i++) {
+            int v = newcache[i];
+            cache[i] = v;
+            vcache[v] = i < VERTEX_CACHE_SIZE ? i : -1;
+        }
+
+        // Rescore vertexes which moved and their triangles, and pick
+        // the best triangle touching the cache.
+        for (int i = 0; i < newcount; i++) {
+            int v = newcache[i];
+            vscore[v] = vertex_score(vcache[v], vremain[v]);
+        }
+        best = -1;
+        float best_score = -1.0f;
+        for (int i = 0; i < cache_count; i++) {
+            int v = cache[i];
+            const unsigned *list = vtri.data() + vstart[v];
+            for (unsigned j = 0; j < vremain[v]; j++) {
+                unsigned u = list[j];
+                const unsigned *uv = index + u * 3;
+                float s = vscore[uv[0]] + vscore[uv[1]] + vscore[uv[2]];
+                tscore[u] = s;
+                if (s > best_score) {
+                    best_score = s;
+                    best = (long) u;
+                }
+            }
+        }
+    }
+
+    std::memcpy(index, out.data(), out.size() * sizeof(unsigned));
+}
+
+double cache_miss_ratio(const unsigned *index, std::size_t count,
+                        std::size_t vertcount) {
+    std::size_t tricount = count / 3;
+    if (!tricount)
+        return 0.0;
+    // Each vertex remembers when it entered the FIFO.
+    std::vector<std::size_t> stamp(vertcount, 0);
+    std::size_t misses = 0;
+    for (std::size_t i = 0; i < tricount * 3; i++) {
+        unsigned v = index[i];
+        if (!stamp[v] || misses - stamp[v] >= (std::size_t) VERTEX_CACHE_SIZE) {
+            misses++;
+            stamp[v] = misses;
+        }
+    }
+    return (double) misses / (double) tricount;
+}
+
+}
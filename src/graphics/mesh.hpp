@@ -0,0 +1,79 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_MESH_HPP
+#define LD_GRAPHICS_MESH_HPP
+#include "base/ibox.hpp"
+#include "sg/opengl.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+namespace Graphics {
+
+/// Size of the simulated post-transform vertex cache.
+const int VERTEX_CACHE_SIZE = 32;
+
+/// Size of mesh tiles, in vertex coordinates.
+const int MESH_TILE_SIZE = 128;
+
+/// A contiguous range of triangles in a mesh, covering a tile.
+struct MeshTile {
+    /// Bounds of the vertexes, in vertex coordinates.
+    Base::IBox3 bounds;
+    /// Offset of the first index.
+    unsigned first;
+    /// Number of indexes.
+    unsigned count;
+};
+
+/// Indexed triangle mesh with 8-byte vertexes.
+class Mesh {
+public:
+    /// Unique vertexes.
+    std::vector<std::uint64_t> vertex;
+    /// Triangle list, three indexes per triangle.
+    std::vector<unsigned> index;
+    /// Tiles, in index order.  If there are multiple levels of
+    /// detail, the tiles for each level are stored consecutively, and
+    /// each level has the same tiles in the same order.
+    std::vector<MeshTile> tile;
+    /// Number of levels of detail.
+    int level_count;
+
+    Mesh();
+
+    /// Build an indexed mesh from an unindexed triangle list.
+    /// Identical vertexes are merged, triangles are grouped into
+    /// tiles, and each tile is reordered for the vertex cache.
+    void build(const void *data, std::size_t size);
+    /// Test whether the mesh is empty.
+    bool empty() const { return index.empty(); }
+    /// Get the number of tiles in each level of detail.
+    std::size_t level_size() const { return tile.size() / level_count; }
+    /// Get the type of index to use for drawing.
+    GLenum index_type() const;
+    /// Get the size of each index, in bytes.
+    std::size_t index_size() const;
+    /// Upload the vertex data to the bound array buffer.
+    void upload_vertex() const;
+    /// Upload the index data to the bound element array buffer.
+    void upload_index() const;
+};
+
+/// Get the position of an 8-byte vertex, in vertex coordinates.
+Base::IVec3 vertex_position(std::uint64_t vertex);
+
+/// Reorder triangles to improve the post-transform vertex cache hit
+/// rate, using Tom Forsyth's linear-speed algorithm.  The order of
+/// vertexes within each triangle is preserved.
+void optimize_triangles(unsigned *index, std::size_t count,
+                        std::size_t vertcount);
+
+/// Calculate the average cache miss ratio (transformed vertexes per
+/// triangle) for a triangle list, simulating a FIFO cache.
+double cache_miss_ratio(const unsigned *index, std::size_t count,
+                        std::size_t vertcount);
+
+}
+#endif
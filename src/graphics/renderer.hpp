@@ -0,0 +1,36 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_RENDERER_HPP
+#define LD_GRAPHICS_RENDERER_HPP
+namespace Base {
+class MemoryReport;
+}
+namespace Game {
+class Game;
+}
+namespace Graphics {
+class Resources;
+
+/// Interface for drawing the game.  The OpenGL renderer is the
+/// System, and the SoftRenderer draws the same frame on the CPU.
+class Renderer {
+public:
+    Renderer() {}
+    Renderer(const Renderer &) = delete;
+    virtual ~Renderer() {}
+    Renderer &operator=(const Renderer &) = delete;
+
+    /// Load all graphical assets.  Assets missing from the resource
+    /// cache are loaded first.
+    virtual bool load(Game::Game &game, Resources &res) = 0;
+    /// Draw the game's graphics.
+    virtual void draw(int width, int height, const Game::Game &game) = 0;
+    /// Add the memory used by the renderer to a report, including an
+    /// estimate of the memory used by OpenGL objects.
+    virtual void report_memory(Base::MemoryReport &report) const = 0;
+};
+
+}
+#endif
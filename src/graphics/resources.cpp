@@ -0,0 +1,376 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "defs.hpp"
+#include "resources.hpp"
+#include "atlas.hpp"
+#include "terrain.hpp"
+#include "text.hpp"
+#include "base/bc1.hpp"
+#include "base/cache.hpp"
+#include "base/file.hpp"
+#include "base/memory.hpp"
+#include "base/task.hpp"
+#include "game/game.hpp"
+#include "sg/type.h"
+#include <cstdint>
+#include <cstring>
+namespace Graphics {
+
+namespace {
+
+/// Whether to generate terrain levels of detail from the heightmap,
+/// instead of drawing the full-detail terrain mesh.
+const bool TERRAIN_LOD = true;
+
+/// Empty space between images in the atlas.  Sprites are drawn with
+/// nearest filtering, but this keeps rounding from showing a
+/// neighbor's edge.
+const int ATLAS_PADDING = 1;
+
+/// Whether to store a BC1 copy of the atlas, which is used instead of
+/// the RGBA pixels if the driver supports S3TC.  BC1 has 5:6:5 color
+/// and one-bit alpha, which is visible on pixel art.
+const bool TEXTURE_COMPRESS = false;
+
+/// Maximum size of a source image file.
+const std::size_t MAX_IMAGE_SIZE = 1u << 24;
+
+const char ATLAS_MAGIC[8] = { 'F', 'e', 'l', 'A', 't', 'l', 's', '1' };
+
+/// Header for a cached atlas.  It is followed by the position of each
+/// sprite in the atlas, the RGBA pixels, and the BC1 blocks.
+struct AtlasHeader {
+    char magic[8];
+    std::uint64_t key;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t sprite_count;
+    std::uint32_t bc1_size;
+    std::int16_t textbox[4];
+};
+
+/// Get the cache key for the atlas.  The key changes whenever the
+/// images, the sprite rectangles, or the packing parameters change.
+std::uint64_t atlas_key(const Base::Data &sheet, const Base::Data &textbox,
+                        const std::vector<sg_sprite> &rects) {
+    std::uint64_t h = Base::hash(ATLAS_MAGIC, sizeof(ATLAS_MAGIC));
+    h = Base::hash(sheet.ptr(), sheet.size(), h);
+    h = Base::hash(textbox.ptr(), textbox.size(), h);
+    h = Base::hash(rects.data(), rects.size() * sizeof(sg_sprite), h);
+    const int params[2] = { ATLAS_PADDING, TEXTURE_COMPRESS };
+    return Base::hash(params, sizeof(params), h);
+}
+
+/// Load the atlas from the cache, and move the sprites.  Returns false
+/// if the atlas is not in the cache or is out of date.
+bool read_atlas(Resources &res, std::vector<sg_sprite> &rects,
+                std::uint64_t key) {
+    std::vector<unsigned char> data;
+    if (!Base::cache_read("atlas.bin", data))
+        return false;
+
+    AtlasHeader head;
+    if (data.size() < sizeof(head))
+        return false;
+    std::memcpy(&head, data.data(), sizeof(head));
+    std::size_t possize = (std::size_t) head.sprite_count * 4;
+    std::size_t rowsize = (std::size_t) head.width * 4;
+    std::size_t pixsize = rowsize * head.height;
+    if (std::memcmp(head.magic, ATLAS_MAGIC, sizeof(ATLAS_MAGIC)) ||
+        head.key != key ||
+        head.sprite_count != rects.size() ||
+        (head.bc1_size != 0 &&
+         head.bc1_size != Base::bc1_size(head.width, head.height)) ||
+        data.size() != sizeof(head) + possize + pixsize + head.bc1_size) {
+        Log::info("Atlas: cached atlas is out of date");
+        return false;
+    }
+
+    const unsigned char *ptr = data.data() + sizeof(head);
+    for (auto &s : rects) {
+        std::int16_t pos[2];
+        std::memcpy(pos, ptr, sizeof(pos));
+        s.x = pos[0];
+        s.y = pos[1];
+        ptr += sizeof(pos);
+    }
+    int width = (int) head.width, height = (int) head.height;
+    res.atlas.pixbuf.calloc(SG_RGBA, width, height);
+    res.atlas.width = width;
+    res.atlas.height = height;
+    unsigned char *pixels =
+        static_cast<unsigned char *>(res.atlas.pixbuf->data);
+    for (int y = 0; y < height; y++) {
+        std::memcpy(pixels + res.atlas.pixbuf->rowbytes * y, ptr, rowsize);
+        ptr += rowsize;
+    }
+    res.atlas_bc1.assign(ptr, ptr + head.bc1_size);
+    for (int i = 0; i < 4; i++) {
+        res.textbox_rect[i] = head.textbox[i];
+    }
+    Log::info("Atlas: %d x %d, from cache", width, height);
+    return true;
+}
+
+/// Save the atlas and the sprite positions to the cache.
+void write_atlas(const Resources &res, const std::vector<sg_sprite> &rects,
+                 std::uint64_t key) {
+    int width = res.atlas.width, height = res.atlas.height;
+    std::size_t possize = rects.size() * 4;
+    std::size_t rowsize = (std::size_t) width * 4;
+    std::size_t pixsize = rowsize * height;
+    std::vector<unsigned char> data(
+        sizeof(AtlasHeader) + possize + pixsize + res.atlas_bc1.size());
+
+    AtlasHeader head;
+    std::memcpy(head.magic, ATLAS_MAGIC, sizeof(ATLAS_MAGIC));
+    head.key = key;
+    head.width = width;
+    head.height = height;
+    head.sprite_count = (std::uint32_t) rects.size();
+    head.bc1_size = (std::uint32_t) res.atlas_bc1.size();
+    for (int i = 0; i < 4; i++) {
+        head.textbox[i] = res.textbox_rect[i];
+    }
+    std::memcpy(data.data(), &head, sizeof(head));
+
+    unsigned char *ptr = data.data() + sizeof(head);
+    for (const auto &s : rects) {
+        const std::int16_t pos[2] = { s.x, s.y };
+        std::memcpy(ptr, pos, sizeof(pos));
+        ptr += sizeof(pos);
+    }
+    const unsigned char *pixels =
+        static_cast<const unsigned char *>(res.atlas.pixbuf->data);
+    for (int y = 0; y < height; y++) {
+        std::memcpy(ptr, pixels + res.atlas.pixbuf->rowbytes * y, rowsize);
+        ptr += rowsize;
+    }
+    if (!res.atlas_bc1.empty()) {
+        std::memcpy(ptr, res.atlas_bc1.data(), res.atlas_bc1.size());
+    }
+
+    Base::cache_write("atlas.bin", data.data(), data.size());
+}
+
+/// Pack the sprites and text box into an atlas, and move the sprites.
+void build_atlas(Resources &res, std::vector<sg_sprite> &rects,
+                 const Base::TextureData &sheet,
+                 const Base::TextureData &textbox) {
+
+    // Frames with the same rectangle share pixels in the atlas.  The
+    // text box is the last rectangle.
+    std::vector<AtlasRect> arects;
+    std::vector<int> index(rects.size(), -1);
+    for (std::size_t i = 0; i < rects.size(); i++) {
+        const auto &s = rects[i];
+        if (s.w <= 0 || s.h <= 0) {
+            continue;
+        }
+        for (std::size_t j = 0; j < i; j++) {
+            const auto &t = rects[j];
+            if (index[j] >= 0 && s.x == t.x && s.y == t.y &&
+                s.w == t.w && s.h == t.h) {
+                index[i] = index[j];
+                break;
+            }
+        }
+        if (index[i] < 0) {
+            index[i] = (int) arects.size();
+            arects.push_back(AtlasRect { s.w, s.h, 0, 0 });
+        }
+    }
+    arects.push_back(AtlasRect { textbox.width, textbox.height, 0, 0 });
+
+    // OpenGL 3 always supports non-power-of-two textures, so the
+    // height is only rounded up to a whole number of BC1 blocks.
+    int width = atlas_width(arects, ATLAS_PADDING);
+    int height = (pack_atlas(arects, width, ATLAS_PADDING) + 3) & ~3;
+    res.atlas.pixbuf.calloc(SG_RGBA, width, height);
+    res.atlas.width = width;
+    res.atlas.height = height;
+
+    std::vector<bool> copied(arects.size(), false);
+    for (std::size_t i = 0; i < rects.size(); i++) {
+        if (index[i] < 0) {
+            continue;
+        }
+        auto &s = rects[i];
+        const auto &a = arects[index[i]];
+        if (!copied[index[i]]) {
+            copy_pixels(res.atlas.pixbuf, a.x, a.y,
+                        sheet.pixbuf, s.x, s.y, s.w, s.h);
+            copied[index[i]] = true;
+        }
+        s.x = (short) a.x;
+        s.y = (short) a.y;
+    }
+    const auto &tb = arects.back();
+    copy_pixels(res.atlas.pixbuf, tb.x, tb.y,
+                textbox.pixbuf, 0, 0, tb.w, tb.h);
+    res.textbox_rect[0] = (short) tb.x;
+    res.textbox_rect[1] = (short) tb.y;
+    res.textbox_rect[2] = (short) tb.w;
+    res.textbox_rect[3] = (short) tb.h;
+
+    std::size_t used = 0, before =
+        (std::size_t) sheet.pixbuf->width * sheet.pixbuf->height +
+        (std::size_t) textbox.pixbuf->width * textbox.pixbuf->height;
+    for (const auto &a : arects) {
+        used += (std::size_t) a.w * a.h;
+    }
+    Log::info("Atlas: %d x %d, %u images, %.0f%% used, "
+              "%u KiB (was %u KiB)",
+              width, height, (unsigned) arects.size(),
+              100.0 * (double) used / ((double) width * height),
+              (unsigned) (width * height * 4 / 1024),
+              (unsigned) (before * 4 / 1024));
+
+    if (TEXTURE_COMPRESS) {
+        Base::bc1_encode(res.atlas_bc1, res.atlas.pixbuf, width, height);
+    } else {
+        res.atlas_bc1.clear();
+    }
+}
+
+}
+
+Resources::Resources()
+    : typeface(nullptr) {
+    for (int i = 0; i < 4; i++) {
+        textbox_rect[i] = 0;
+    }
+}
+
+Resources::~Resources() {
+    if (typeface) {
+        sg_typeface_decref(typeface);
+    }
+}
+
+bool Resources::load(Game::Game &game, bool shaders) {
+    bool atlas_ok = atlas.pixbuf->data != nullptr;
+    bool textbox_ok = true, sprite_ok = true;
+    Base::Data textbox_file, sprite_file;
+    Base::TextureData textbox, sprite;
+    std::vector<sg_sprite> rects;
+    std::uint64_t atlas_hash = 0;
+    sg_typeface *new_typeface = nullptr;
+
+    // The source images are only decoded if the cached atlas is
+    // missing or out of date.
+    if (!atlas_ok) {
+        textbox_file.read("image/textbox", MAX_IMAGE_SIZE, "png");
+        sprite_file.read("image/sprite", MAX_IMAGE_SIZE, "png");
+        rects = game.sprites().rects();
+        atlas_hash = atlas_key(sprite_file, textbox_file, rects);
+        atlas_ok = read_atlas(*this, rects, atlas_hash);
+        if (atlas_ok) {
+            game.sprites().set_rects(std::move(rects));
+        } else {
+            textbox_ok = false;
+            sprite_ok = false;
+        }
+    }
+
+    {
+        Base::TaskGroup tasks("Graphics::load");
+        if (!textbox_ok) {
+            tasks.add("image/textbox", [&] {
+                textbox_ok = textbox.load(textbox_file);
+            });
+        }
+        if (!sprite_ok) {
+            tasks.add("image/sprite", [&] {
+                sprite_ok = sprite.load(sprite_file);
+            });
+        }
+        if (!typeface) {
+            tasks.add("font/Alegreya-Bold", [&] {
+                const char *path = "font/Alegreya-Bold";
+                new_typeface = sg_typeface_file(
+                    path, std::strlen(path), nullptr);
+            });
+        }
+        if (charset.empty()) {
+            tasks.add("charset", [&] {
+                charset = text_charset(game.machine().dialog_text());
+            });
+        }
+        if (terrain.empty()) {
+            tasks.add("terrain", [&] {
+                const auto &world = game.world();
+                auto vdata = world.vertex_data();
+                terrain.build(vdata.first, vdata.second);
+                if (TERRAIN_LOD) {
+                    Mesh lod;
+                    if (build_terrain(lod, terrain, world)) {
+                        terrain = std::move(lod);
+                    }
+                }
+                bake_terrain(terrain_baked, terrain.vertex,
+                             terrain_lighting(world.vertex_scale()));
+            });
+        }
+        if (shaders && m_shader_path != Base::shader_path) {
+            tasks.add("shaders", [&] {
+                prog_overlay.read("overlay", "overlay");
+                prog_world.read("world", "world");
+                prog_world_baked.read("world_baked", "world");
+                prog_sprite.read("sprite", "sprite");
+            });
+            m_shader_path = Base::shader_path;
+        }
+        tasks.wait();
+    }
+
+    if (!atlas_ok && textbox_ok && sprite_ok) {
+        build_atlas(*this, rects, sprite, textbox);
+        write_atlas(*this, rects, atlas_hash);
+        game.sprites().set_rects(std::move(rects));
+        atlas_ok = true;
+    }
+
+    if (new_typeface) {
+        if (typeface) {
+            sg_typeface_decref(typeface);
+        }
+        typeface = new_typeface;
+    }
+
+    bool success = true;
+    if (!textbox_ok) {
+        Log::warn("Could not load image: image/textbox");
+        success = false;
+    }
+    if (!sprite_ok) {
+        Log::warn("Could not load image: image/sprite");
+        success = false;
+    }
+    if (!typeface) {
+        Log::warn("Could not load font: font/Alegreya-Bold");
+        success = false;
+    }
+    return success;
+}
+
+void Resources::report_memory(Base::MemoryReport &report) const {
+    report.add("sprites", atlas.pixbuf);
+    report.add("sprites", atlas_bc1);
+    report.add("text", charset);
+    report.add("world", terrain.vertex);
+    report.add("world", terrain.index);
+    report.add("world", terrain.tile);
+    report.add("world", terrain_baked);
+    const Base::ProgramSource *prog[4] = {
+        &prog_overlay, &prog_world, &prog_world_baked, &prog_sprite
+    };
+    for (auto p : prog) {
+        report.add("shaders", p->vertex);
+        report.add("shaders", p->fragment);
+    }
+}
+
+}
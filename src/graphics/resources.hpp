@@ -0,0 +1,67 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_RESOURCES_HPP
+#define LD_GRAPHICS_RESOURCES_HPP
+#include "bake.hpp"
+#include "mesh.hpp"
+#include "base/image.hpp"
+#include "base/shader.hpp"
+#include <string>
+#include <vector>
+struct sg_typeface;
+namespace Base {
+class MemoryReport;
+}
+namespace Game {
+class Game;
+}
+namespace Graphics {
+
+/// CPU-side copies of the graphics assets.  These are read from disk
+/// and decoded on worker threads, and do not need an OpenGL context.
+/// The resources outlive the graphics system, so when the OpenGL
+/// context is recreated, only the uploads have to be redone.
+class Resources {
+private:
+    std::string m_shader_path;
+
+public:
+    /// Texture containing the sprites and the text box.  The sprite
+    /// data is changed to refer to the atlas when it is built.
+    Base::TextureData atlas;
+    /// Rectangle for the text box in the atlas: x, y, width, height.
+    short textbox_rect[4];
+    /// BC1 blocks for the atlas, or empty if it is not compressed.
+    std::vector<unsigned char> atlas_bc1;
+    sg_typeface *typeface;
+    /// Every character in the script's dialog, so the font can be
+    /// rasterized before any text is shown.
+    std::string charset;
+    Mesh terrain;
+    /// Terrain vertexes with the static lighting baked in, in the
+    /// same order as the terrain mesh vertexes.
+    std::vector<BakedVertex> terrain_baked;
+
+    Base::ProgramSource prog_overlay;
+    Base::ProgramSource prog_world;
+    Base::ProgramSource prog_world_baked;
+    Base::ProgramSource prog_sprite;
+
+    Resources();
+    Resources(const Resources &) = delete;
+    ~Resources();
+    Resources &operator=(const Resources &) = delete;
+
+    /// Load all assets which are not already loaded, in parallel.
+    /// Shaders are read from the current shader path, and are
+    /// reloaded if the shader path changes.  Renderers which do not
+    /// use OpenGL can skip the shaders.
+    bool load(Game::Game &game, bool shaders = true);
+    /// Add the memory used to a report.
+    void report_memory(Base::MemoryReport &report) const;
+};
+
+}
+#endif
@@ -6,46 +6,63 @@
 namespace Graphics {
 namespace Shader {
 using Base::ShaderField;
+using Base::ShaderBlock;
 
 #define AFIELD(name) { "in_" #name,       offsetof(TYPE, a_ ## name) }
 #define UFIELD(name) {  "u_" #name,       offsetof(TYPE, u_ ## name) }
 #define UARRAY(name) {  "u_" #name "[0]", offsetof(TYPE, u_ ## name) }
+#define BLOCK(name, binding) { #name, binding }
 
-#define TYPE Text
+#define TYPE Overlay
 const ShaderField TYPE::UNIFORMS[] = {
-    UFIELD(vertxform),
-    UFIELD(texscale),
     UFIELD(texture),
-    UFIELD(color),
     { nullptr, 0 }
 };
 
 const ShaderField TYPE::ATTRIBUTES[] = {
-    AFIELD(vert),
+    AFIELD(pos),
+    AFIELD(texcoord),
+    AFIELD(color),
+    AFIELD(mode),
+    { nullptr, 0 }
+};
+
+const ShaderBlock TYPE::BLOCKS[] = {
     { nullptr, 0 }
 };
 #undef TYPE
 
 #define TYPE Sprite
 const ShaderField TYPE::UNIFORMS[] = {
-    UFIELD(modelview),
+    UFIELD(worldview),
     UFIELD(projection),
     UFIELD(texscale),
     UFIELD(texture),
+    UFIELD(right),
+    UFIELD(up),
     { nullptr, 0 }
 };
 
 const ShaderField TYPE::ATTRIBUTES[] = {
-    AFIELD(vert),
-    AFIELD(texcoord),
+    AFIELD(pos),
+    AFIELD(rect),
+    AFIELD(center),
+    AFIELD(corner),
+    AFIELD(orient),
+    { nullptr, 0 }
+};
+
+const ShaderBlock TYPE::BLOCKS[] = {
+    BLOCK(Camera, CAMERA_BLOCK),
     { nullptr, 0 }
 };
 #undef TYPE
 
 #define TYPE World
 const ShaderField TYPE::UNIFORMS[] = {
-    UFIELD(modelview),
+    UFIELD(worldview),
     UFIELD(projection),
+    UFIELD(vertex_scale),
     UFIELD(normalmat),
     UARRAY(terrain_color),
     UARRAY(light_dir),
@@ -59,16 +76,32 @@ const ShaderField TYPE::ATTRIBUTES[] = {
     AFIELD(normal),
     { nullptr, 0 }
 };
+
+const ShaderBlock TYPE::BLOCKS[] = {
+    BLOCK(Camera, CAMERA_BLOCK),
+    BLOCK(World, WORLD_BLOCK),
+    { nullptr, 0 }
+};
 #undef TYPE
 
-#define TYPE Ui
+#define TYPE WorldBaked
 const ShaderField TYPE::UNIFORMS[] = {
-    UFIELD(texture),
+    UFIELD(worldview),
+    UFIELD(projection),
+    UFIELD(vertex_scale),
     { nullptr, 0 }
 };
 
 const ShaderField TYPE::ATTRIBUTES[] = {
     AFIELD(vert),
+    AFIELD(color),
+    AFIELD(light),
+    { nullptr, 0 }
+};
+
+const ShaderBlock TYPE::BLOCKS[] = {
+    BLOCK(Camera, CAMERA_BLOCK),
+    BLOCK(World, WORLD_BLOCK),
     { nullptr, 0 }
 };
 #undef TYPE
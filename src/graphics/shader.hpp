@@ -8,41 +8,57 @@
 namespace Graphics {
 namespace Shader {
 
-/// Uniforms and attributes for the "text" shader.
-struct Text {
+/// Binding point for the "Camera" uniform block.
+const GLuint CAMERA_BLOCK = 0;
+/// Binding point for the "World" uniform block.
+const GLuint WORLD_BLOCK = 1;
+
+// Uniforms in blocks are also listed as ordinary uniforms, for GLSL
+// 1.30, which does not have uniform blocks.
+
+/// Uniforms and attributes for the "overlay" shader.
+struct Overlay {
     static const Base::ShaderField UNIFORMS[];
     static const Base::ShaderField ATTRIBUTES[];
+    static const Base::ShaderBlock BLOCKS[];
 
     // Attributes
-    GLint a_vert;
+    GLint a_pos;
+    GLint a_texcoord;
+    GLint a_color;
+    GLint a_mode;
 
     // Uniforms
-    GLint u_vertxform;
-    GLint u_texscale;
     GLint u_texture;
-    GLint u_color;
 };
 
 /// Uniforms and attributes for the "sprite" shader.
 struct Sprite {
     static const Base::ShaderField UNIFORMS[];
     static const Base::ShaderField ATTRIBUTES[];
+    static const Base::ShaderBlock BLOCKS[];
 
     // Attributes
-    GLint a_vert;
-    GLint a_texcoord;
+    GLint a_pos;
+    GLint a_rect;
+    GLint a_center;
+    GLint a_corner;
+    GLint a_orient;
 
     // Uniforms
-    GLint u_modelview;
+    GLint u_worldview;
     GLint u_projection;
     GLint u_texscale;
     GLint u_texture;
+    GLint u_right;
+    GLint u_up;
 };
 
-/// Uniforms and attributes for the "sprite" shader.
+/// Uniforms and attributes for the "world" shader.
 struct World {
     static const Base::ShaderField UNIFORMS[];
     static const Base::ShaderField ATTRIBUTES[];
+    static const Base::ShaderBlock BLOCKS[];
 
     // Attributes
     GLint a_vert;
@@ -50,24 +66,30 @@ struct World {
     GLint a_normal;
 
     // Uniforms
-    GLint u_modelview;
+    GLint u_worldview;
     GLint u_projection;
+    GLint u_vertex_scale;
     GLint u_normalmat;
     GLint u_terrain_color;
     GLint u_light_dir;
     GLint u_light_color;
 };
 
-/// Uniforms and attributes for the "ui" shader.
-struct Ui {
+/// Uniforms and attributes for the "world_baked" shader.
+struct WorldBaked {
     static const Base::ShaderField UNIFORMS[];
     static const Base::ShaderField ATTRIBUTES[];
+    static const Base::ShaderBlock BLOCKS[];
 
     // Attributes
     GLint a_vert;
+    GLint a_color;
+    GLint a_light;
 
     // Uniforms
-    GLint u_texture;
+    GLint u_worldview;
+    GLint u_projection;
+    GLint u_vertex_scale;
 };
 
 }
@@ -0,0 +1,658 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "defs.hpp"
+#include "soft.hpp"
+#include "frustum.hpp"
+#include "resources.hpp"
+#include "sprite.hpp"
+#include "terrain.hpp"
+#include "view.hpp"
+#include "game/game.hpp"
+#include "game/person.hpp"
+#include "base/arena.hpp"
+#include "base/memory.hpp"
+#include "base/task.hpp"
+#include "base/timer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#if defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define LD_SOFT_SSE2 1
+#include <emmintrin.h>
+#endif
+namespace Graphics {
+
+namespace {
+
+/// Whether to log the number of triangles and the time for each frame.
+const bool debug_stats = false;
+
+/// Size of the screen tiles, in pixels.  Must be a multiple of 4.
+const int TILE_SIZE = 64;
+
+/// Background color, the same as the OpenGL clear color.
+const unsigned char CLEAR_COLOR[4] = { 0, 26, 51, 0 };
+
+typedef SoftRenderer::Triangle Triangle;
+
+/// Where pixels are written.
+struct Target {
+    unsigned char *color;
+    std::size_t rowbytes;
+    float *depth;
+    int stride;
+    int height;
+    const Base::TextureData *atlas;
+};
+
+/// Get the plane equation for a value at the vertexes of a triangle.
+void make_plane(float out[3], const float *x, const float *y,
+                const float *v, float inv_area) {
+    float dx1 = x[1] - x[0], dy1 = y[1] - y[0];
+    float dx2 = x[2] - x[0], dy2 = y[2] - y[0];
+    float dv1 = v[1] - v[0], dv2 = v[2] - v[0];
+    out[0] = (dv1 * dy2 - dv2 * dy1) * inv_area;
+    out[1] = (dv2 * dx1 - dv1 * dx2) * inv_area;
+    out[2] = v[0] - out[0] * x[0] - out[1] * y[0];
+}
+
+/// Convert a coordinate to a pixel index, from 0 to limit.
+int clamp_pixel(float x, int limit) {
+    if (!(x > 0.0f)) {
+        return 0;
+    }
+    return x >= (float) limit ? limit : (int) x;
+}
+
+unsigned char to_byte(float x) {
+    x = x * 255.0f + 0.5f;
+    return (unsigned char) (x < 0.0f ? 0.0f : x > 255.0f ? 255.0f : x);
+}
+
+/// Blend a color channel, like glBlendFunc(GL_SRC_ALPHA,
+/// GL_ONE_MINUS_SRC_ALPHA).
+inline unsigned char blend(unsigned src, unsigned dest, unsigned alpha) {
+    return (unsigned char) ((src * alpha + dest * (255 - alpha) + 127) / 255);
+}
+
+/// Shade a pixel which passed the coverage and depth tests.  Images
+/// may still discard the pixel, the same way the shaders do.
+inline void shade(const Target &g, const Triangle &t,
+                  int x, int y, float z) {
+    float fx = (float) x + 0.5f, fy = (float) y + 0.5f;
+    float a[3];
+    for (int i = 0; i < 3; i++) {
+        a[i] = t.attr[i][0] * fx + t.attr[i][1] * fy + t.attr[i][2];
+    }
+    // Rows are stored top first, window coordinates are bottom first.
+    unsigned char *out = g.color + g.rowbytes * (g.height - 1 - y) + 4 * x;
+    if (t.kind == Triangle::TERRAIN) {
+        for (int i = 0; i < 3; i++) {
+            out[i] = to_byte(a[i] * t.light[i]);
+        }
+        out[3] = 255;
+        g.depth[g.stride * y + x] = z;
+        return;
+    }
+
+    const auto &pb = g.atlas->pixbuf;
+    int u = std::max(0, std::min(pb->width - 1, (int) std::floor(a[0])));
+    int v = std::max(0, std::min(pb->height - 1, (int) std::floor(a[1])));
+    const unsigned char *s =
+        static_cast<const unsigned char *>(pb->data) +
+        pb->rowbytes * v + 4 * u;
+    if (t.kind == Triangle::IMAGE) {
+        // The sprite shader only discards fully transparent texels,
+        // the rest are blended and write depth.
+        unsigned alpha = s[3];
+        if (!alpha) {
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            out[i] = blend(s[i], out[i], alpha);
+        }
+        out[3] = blend(alpha, out[3], alpha);
+        g.depth[g.stride * y + x] = z;
+    } else {
+        // The overlay shader alpha tests the box and makes it opaque.
+        if (s[3] < 128) {
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            out[i] = s[i];
+        }
+        out[3] = 255;
+    }
+}
+
+/// Rasterize the pixels x0 <= x < x1 in one row of a triangle.
+void raster_span(const Target &g, const Triangle &t,
+                 int y, int x0, int x1) {
+    const float fy = (float) y + 0.5f;
+    // The depth test passes for equal depth, like GL_LEQUAL, so the
+    // parts of a person are drawn over each other in order.
+    const bool test = t.kind != Triangle::OVERLAY;
+    float row[3];
+    for (int i = 0; i < 3; i++) {
+        row[i] = t.edge[i][1] * fy + t.edge[i][2];
+    }
+    const float zrow = t.depth[1] * fy + t.depth[2];
+    float *drow = g.depth + g.stride * y;
+
+#if defined LD_SOFT_SSE2
+    // Four pixels at a time.  Groups are aligned, so they never cross
+    // a tile boundary or the end of a padded depth buffer row.
+    const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+    const __m128 vx0 = _mm_set1_ps((float) x0);
+    const __m128 vx1 = _mm_set1_ps((float) x1);
+    __m128 ea[3], erow[3], eth[3];
+    for (int i = 0; i < 3; i++) {
+        ea[i] = _mm_set1_ps(t.edge[i][0]);
+        erow[i] = _mm_set1_ps(row[i]);
+        eth[i] = _mm_set1_ps(t.threshold[i]);
+    }
+    const __m128 za = _mm_set1_ps(t.depth[0]), zr = _mm_set1_ps(zrow);
+    for (int x = x0 & ~3; x < x1; x += 4) {
+        __m128 px = _mm_add_ps(_mm_set1_ps((float) x), lane);
+        __m128 fx = _mm_add_ps(px, half);
+        __m128 mask = _mm_and_ps(_mm_cmpge_ps(px, vx0),
+                                 _mm_cmplt_ps(px, vx1));
+        for (int i = 0; i < 3; i++) {
+            __m128 e = _mm_add_ps(_mm_mul_ps(ea[i], fx), erow[i]);
+            mask = _mm_and_ps(mask, _mm_cmpge_ps(e, eth[i]));
+        }
+        if (!_mm_movemask_ps(mask)) {
+            continue;
+        }
+        __m128 z = _mm_add_ps(_mm_mul_ps(za, fx), zr);
+        if (test) {
+            __m128 d = _mm_loadu_ps(drow + x);
+            mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmple_ps(z, d),
+                                               _mm_cmpge_ps(z, zero)));
+        }
+        int bits = _mm_movemask_ps(mask);
+        if (!bits) {
+            continue;
+        }
+        float zs[4];
+        _mm_storeu_ps(zs, z);
+        for (int k = 0; k < 4; k++) {
+            if (bits & (1 << k)) {
+                shade(g, t, x + k, y, zs[k]);
+            }
+        }
+    }
+#else
+    for (int x = x0; x < x1; x++) {
+        float fx = (float) x + 0.5f;
+        bool inside = true;
+        for (int i = 0; i < 3; i++) {
+            inside = inside && t.edge[i][0] * fx + row[i] >= t.threshold[i];
+        }
+        if (!inside) {
+            continue;
+        }
+        float z = t.depth[0] * fx + zrow;
+        if (test && !(z <= drow[x] && z >= 0.0f)) {
+            continue;
+        }
+        shade(g, t, x, y, z);
+    }
+#endif
+}
+
+}
+
+SoftRenderer::SoftRenderer(bool present)
+    : m_present(present),
+      m_level_count(1),
+      m_vertex_scale(Vec3::zero()),
+      m_atlas(nullptr),
+      m_width(0),
+      m_height(0),
+      m_depth_stride(0),
+      m_stamp(0),
+      m_tiles_x(0),
+      m_tiles_y(0),
+      m_texture(0),
+      m_framebuffer(0) {
+    for (int i = 0; i < 4; i++) {
+        m_textbox[i] = 0;
+    }
+}
+
+SoftRenderer::~SoftRenderer() {
+    if (m_texture) {
+        glDeleteTextures(1, &m_texture);
+    }
+    if (m_framebuffer) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+    }
+}
+
+bool SoftRenderer::load(Game::Game &game, Resources &res) {
+    bool success = true;
+    if (!res.load(game, false)) {
+        success = false;
+    }
+
+    Base::Timer timer;
+    const auto &mesh = res.terrain;
+    m_vertex_scale = game.world().vertex_scale();
+    m_vertex = res.terrain_baked;
+    m_index = mesh.index;
+    m_tile = mesh.tile;
+    m_level_count = mesh.level_count;
+    m_clip.assign(m_vertex.size() * 4, 0.0f);
+    m_clip_stamp.assign(m_vertex.size(), 0);
+    m_stamp = 0;
+
+    m_sprite_cache.clear();
+    if (res.atlas.pixbuf->data) {
+        m_atlas = &res.atlas;
+    } else {
+        m_atlas = nullptr;
+        success = false;
+    }
+    for (int i = 0; i < 4; i++) {
+        m_textbox[i] = res.textbox_rect[i];
+    }
+
+    Log::info("Software renderer: %u vertexes, %d threads: %.1f ms",
+              (unsigned) m_vertex.size(), Base::TaskGroup::thread_count(),
+              timer.elapsed_ms());
+    return success;
+}
+
+void SoftRenderer::draw(int width, int height, const Game::Game &game) {
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    Base::Timer timer;
+    resize(width, height);
+    View v(width, height);
+
+    // Triangles are rasterized in this order within each tile, which
+    // is the same order the System draws them.
+    m_tri.clear();
+    add_terrain(v);
+    add_sprites(v, game);
+    add_overlay(v, game);
+    bin_triangles();
+    double setup_time = timer.elapsed_ms();
+
+    {
+        // The tasks come from the frame arena, and the captures are
+        // small enough that std::function does not allocate either.
+        Base::TaskGroup tasks(Base::frame_arena);
+        std::atomic<int> next(0);
+        for (int i = 0, n = Base::TaskGroup::thread_count(); i < n; i++) {
+            tasks.add("raster", [this, &next] {
+                const int count = m_tiles_x * m_tiles_y;
+                int tile;
+                while ((tile = next++) < count) {
+                    raster_tile(tile);
+                }
+            });
+        }
+        tasks.wait();
+    }
+
+    if (debug_stats) {
+        Log::info("Software frame: %u triangles, "
+                  "setup %.1f ms, total %.1f ms",
+                  (unsigned) m_tri.size(), setup_time, timer.elapsed_ms());
+    }
+    if (m_present) {
+        present();
+    }
+}
+
+void SoftRenderer::report_memory(Base::MemoryReport &report) const {
+    report.add("soft", m_vertex);
+    report.add("soft", m_index);
+    report.add("soft", m_tile);
+    report.add("soft", m_color);
+    report.add("soft", m_depth);
+    report.add("soft", m_clip);
+    report.add("soft", m_clip_stamp);
+    report.add("soft", m_tri);
+    report.add("soft", m_bin);
+    for (const auto &bin : m_bin) {
+        report.add("soft", bin);
+    }
+    if (m_texture) {
+        report.add("soft", Base::MemKind::GPU_TEXTURE,
+                   (std::size_t) m_width * m_height * 4);
+    }
+    m_sprite_cache.report_memory(report);
+}
+
+void SoftRenderer::resize(int width, int height) {
+    if (width == m_width && height == m_height) {
+        return;
+    }
+    m_width = width;
+    m_height = height;
+    m_color.calloc(SG_RGBA, width, height);
+    m_depth_stride = (width + 3) & ~3;
+    m_depth.assign((std::size_t) m_depth_stride * height, 1.0f);
+    m_tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    m_bin.resize((std::size_t) m_tiles_x * m_tiles_y);
+}
+
+void SoftRenderer::add_terrain(const View &v) {
+    if (m_tile.empty()) {
+        return;
+    }
+    Mat4 mvp = v.projection * v.worldview * Mat4::scale(m_vertex_scale);
+    Frustum frustum = Frustum::from_matrix(mvp);
+
+    // Each vertex is transformed once per frame, when it is first used.
+    m_stamp++;
+    if (!m_stamp) {
+        std::fill(m_clip_stamp.begin(), m_clip_stamp.end(), 0);
+        m_stamp = 1;
+    }
+
+    std::size_t level_size = m_tile.size() / m_level_count;
+    for (std::size_t i = 0; i < level_size; i++) {
+        int level = 0;
+        if (m_level_count > 1) {
+            const auto &b = m_tile[i].bounds;
+            Vec3 center;
+            for (int j = 0; j < 3; j++) {
+                center[j] = 0.5f * m_vertex_scale[j] *
+                    (float) (b.mins[j] + b.maxs[j]);
+            }
+            Vec3 d = center - v.camera_pos;
+            level = std::min(m_level_count - 1,
+                             terrain_lod(std::sqrt(Vec3::dot(d, d))));
+        }
+        const auto &tile = m_tile[level * level_size + i];
+        if (!frustum.test(tile.bounds)) {
+            continue;
+        }
+        for (unsigned j = 0; j + 3 <= tile.count; j += 3) {
+            float pos[3][4], attr[3][3];
+            const BakedVertex *bv[3];
+            for (int k = 0; k < 3; k++) {
+                unsigned idx = m_index[tile.first + j + k];
+                float *clip = &m_clip[(std::size_t) idx * 4];
+                bv[k] = &m_vertex[idx];
+                if (m_clip_stamp[idx] != m_stamp) {
+                    m_clip_stamp[idx] = m_stamp;
+                    auto p = vertex_position(bv[k]->pos);
+                    Vec3 vp {{ (float) p[0], (float) p[1], (float) p[2] }};
+                    mvp.transform_points(
+                        reinterpret_cast<float (*)[4]>(clip), &vp, 1);
+                }
+                for (int n = 0; n < 4; n++) {
+                    pos[k][n] = clip[n];
+                }
+                for (int n = 0; n < 3; n++) {
+                    attr[k][n] = (float) bv[k]->color[n] * (1.0f / 255.0f);
+                }
+            }
+            Triangle *t = add_triangle(pos, attr, Triangle::TERRAIN, true);
+            if (t) {
+                // Lighting is flat, from the last vertex, like OpenGL.
+                for (int n = 0; n < 3; n++) {
+                    t->light[n] = (float) bv[2]->light[n] *
+                        (BAKED_LIGHT_SCALE / 255.0f);
+                }
+            }
+        }
+    }
+}
+
+void SoftRenderer::add_sprites(const View &v, const Game::Game &game) {
+    if (!m_atlas) {
+        return;
+    }
+    const auto &people = game.person();
+    Base::FrameVector<SpriteArray::Instance> data(
+        people.size() * Game::PART_COUNT);
+    SpriteArray sprites;
+    sprites.begin(data.data(), (unsigned) data.size(), true);
+    float frac = game.frame_frac();
+    sprites.add_people(m_sprite_cache, game.sprites(), people, frac,
+                       v.worldview, v.sprite_right, v.sprite_up);
+
+    // This does the same work as the "sprite" vertex shader.
+    static const int CORNER[4][2] = {
+        { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 }
+    };
+    static const int QUAD[2][3] = { { 0, 1, 2 }, { 2, 1, 3 } };
+    Mat4 mvp = v.projection * v.worldview;
+    for (unsigned i = 0; i < sprites.size(); i++) {
+        const auto &s = data[i];
+        Vec3 up = (s.orient & 4) ? -v.sprite_up : v.sprite_up;
+        Vec3 right = v.sprite_right, nright, nup;
+        switch (s.orient & 3) {
+        case 0: nright = right; nup = up; break;
+        case 1: nright = up; nup = -right; break;
+        case 2: nright = -right; nup = -up; break;
+        default: nright = -up; nup = right; break;
+        }
+        float w = s.rect[2], h = s.rect[3];
+        Vec3 corner[4];
+        float pos[4][4], attr[4][3];
+        for (int c = 0; c < 4; c++) {
+            float cx = (float) CORNER[c][0], cy = (float) CORNER[c][1];
+            float lx = cx * w - s.center[0];
+            float ly = cy * h - (h - s.center[1]);
+            corner[c] = s.pos + lx * nright + ly * nup;
+            attr[c][0] = s.rect[0] + cx * w;
+            attr[c][1] = s.rect[1] + (1.0f - cy) * h;
+            attr[c][2] = 0.0f;
+        }
+        mvp.transform_points(pos, corner, 4);
+        for (const auto &tri : QUAD) {
+            float tpos[3][4], tattr[3][3];
+            for (int k = 0; k < 3; k++) {
+                std::memcpy(tpos[k], pos[tri[k]], sizeof(tpos[k]));
+                std::memcpy(tattr[k], attr[tri[k]], sizeof(tattr[k]));
+            }
+            add_triangle(tpos, tattr, Triangle::IMAGE, false);
+        }
+    }
+}
+
+void SoftRenderer::add_overlay(const View &v, const Game::Game &game) {
+    if (!m_atlas || game.machine().text().empty()) {
+        return;
+    }
+    float rect[4];
+    v.textbox(rect);
+    float u0 = m_textbox[0], v0 = m_textbox[1];
+    float u1 = u0 + m_textbox[2], v1 = v0 + m_textbox[3];
+    const float pos0[3][4] = {
+        { rect[0], rect[1], 0.0f, 1.0f },
+        { rect[2], rect[1], 0.0f, 1.0f },
+        { rect[0], rect[3], 0.0f, 1.0f }
+    };
+    const float pos1[3][4] = {
+        { rect[0], rect[3], 0.0f, 1.0f },
+        { rect[2], rect[1], 0.0f, 1.0f },
+        { rect[2], rect[3], 0.0f, 1.0f }
+    };
+    const float attr0[3][3] = {
+        { u0, v1, 0.0f }, { u1, v1, 0.0f }, { u0, v0, 0.0f }
+    };
+    const float attr1[3][3] = {
+        { u0, v0, 0.0f }, { u1, v1, 0.0f }, { u1, v0, 0.0f }
+    };
+    add_triangle(pos0, attr0, Triangle::OVERLAY, false);
+    add_triangle(pos1, attr1, Triangle::OVERLAY, false);
+}
+
+SoftRenderer::Triangle *SoftRenderer::add_triangle(
+    const float (*pos)[4], const float (*attr)[3],
+    Triangle::Kind kind, bool cull) {
+    // Triangles which cross the plane w = 0 are dropped instead of
+    // clipped.  The camera never gets close enough to the terrain or
+    // sprites for this to happen.  The depth test takes care of the
+    // near and far planes.
+    float x[3], y[3], z[3];
+    for (int k = 0; k < 3; k++) {
+        float w = pos[k][3];
+        if (!(w > 0.0f)) {
+            return nullptr;
+        }
+        float iw = 1.0f / w;
+        x[k] = (pos[k][0] * iw * 0.5f + 0.5f) * (float) m_width;
+        y[k] = (pos[k][1] * iw * 0.5f + 0.5f) * (float) m_height;
+        z[k] = pos[k][2] * iw * 0.5f + 0.5f;
+    }
+
+    // Counter-clockwise triangles face the camera.
+    float area = (x[1] - x[0]) * (y[2] - y[0]) -
+        (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(area != 0.0f)) {
+        return nullptr;
+    }
+    int order[3] = { 0, 1, 2 };
+    if (area < 0.0f) {
+        if (cull) {
+            return nullptr;
+        }
+        std::swap(order[1], order[2]);
+        area = -area;
+    }
+
+    // Pixels are covered if their center is inside the triangle.
+    float xmin = std::min(x[0], std::min(x[1], x[2]));
+    float xmax = std::max(x[0], std::max(x[1], x[2]));
+    float ymin = std::min(y[0], std::min(y[1], y[2]));
+    float ymax = std::max(y[0], std::max(y[1], y[2]));
+    int bounds[4] = {
+        clamp_pixel(std::ceil(xmin - 0.5f), m_width),
+        clamp_pixel(std::ceil(ymin - 0.5f), m_height),
+        clamp_pixel(std::floor(xmax - 0.5f) + 1.0f, m_width),
+        clamp_pixel(std::floor(ymax - 0.5f) + 1.0f, m_height)
+    };
+    if (bounds[0] >= bounds[2] || bounds[1] >= bounds[3]) {
+        return nullptr;
+    }
+
+    m_tri.emplace_back();
+    Triangle &t = m_tri.back();
+    float tx[3], ty[3], tz[3], ta[3][3];
+    for (int k = 0; k < 3; k++) {
+        int n = order[k];
+        tx[k] = x[n];
+        ty[k] = y[n];
+        tz[k] = z[n];
+        for (int i = 0; i < 3; i++) {
+            ta[i][k] = attr[n][i];
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        int a = i, b = (i + 1) % 3;
+        float ea = ty[a] - ty[b], eb = tx[b] - tx[a];
+        t.edge[i][0] = ea;
+        t.edge[i][1] = eb;
+        t.edge[i][2] = -(ea * tx[a] + eb * ty[a]);
+        // Top-left rule: pixels exactly on an edge belong to only one
+        // of the triangles sharing it.
+        bool top_left = ea > 0.0f || (ea == 0.0f && eb < 0.0f);
+        t.threshold[i] = top_left ?
+            0.0f : std::numeric_limits<float>::denorm_min();
+    }
+    float inv_area = 1.0f / area;
+    make_plane(t.depth, tx, ty, tz, inv_area);
+    for (int i = 0; i < 3; i++) {
+        make_plane(t.attr[i], tx, ty, ta[i], inv_area);
+        t.light[i] = 1.0f;
+    }
+    for (int i = 0; i < 4; i++) {
+        t.bounds[i] = bounds[i];
+    }
+    t.kind = kind;
+    return &t;
+}
+
+void SoftRenderer::bin_triangles() {
+    for (auto &bin : m_bin) {
+        bin.clear();
+    }
+    for (std::size_t i = 0; i < m_tri.size(); i++) {
+        const int *b = m_tri[i].bounds;
+        int tx0 = b[0] / TILE_SIZE, tx1 = (b[2] - 1) / TILE_SIZE;
+        int ty0 = b[1] / TILE_SIZE, ty1 = (b[3] - 1) / TILE_SIZE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                m_bin[ty * m_tiles_x + tx].push_back((unsigned) i);
+            }
+        }
+    }
+}
+
+void SoftRenderer::raster_tile(int tile) {
+    int tx = tile % m_tiles_x, ty = tile / m_tiles_x;
+    int x0 = tx * TILE_SIZE, x1 = std::min(x0 + TILE_SIZE, m_width);
+    int y0 = ty * TILE_SIZE, y1 = std::min(y0 + TILE_SIZE, m_height);
+    Target g {
+        static_cast<unsigned char *>(m_color->data),
+        m_color->rowbytes,
+        m_depth.data(),
+        m_depth_stride,
+        m_height,
+        m_atlas
+    };
+
+    for (int y = y0; y < y1; y++) {
+        unsigned char *crow = g.color + g.rowbytes * (m_height - 1 - y);
+        for (int x = x0; x < x1; x++) {
+            for (int i = 0; i < 4; i++) {
+                crow[x * 4 + i] = CLEAR_COLOR[i];
+            }
+        }
+        float *drow = g.depth + g.stride * y;
+        std::fill(drow + x0, drow + x1, 1.0f);
+    }
+
+    for (unsigned idx : m_bin[tile]) {
+        const Triangle &t = m_tri[idx];
+        int bx0 = std::max(x0, t.bounds[0]), bx1 = std::min(x1, t.bounds[2]);
+        int by0 = std::max(y0, t.bounds[1]), by1 = std::min(y1, t.bounds[3]);
+        for (int y = by0; y < by1; y++) {
+            raster_span(g, t, y, bx0, bx1);
+        }
+    }
+}
+
+void SoftRenderer::present() {
+    if (!m_texture) {
+        glGenTextures(1, &m_texture);
+        glGenFramebuffers(1, &m_framebuffer);
+    }
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint) (m_color->rowbytes / 4));
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, m_color->data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, m_texture, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    // The top row is first, so the image is flipped.
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, m_height, m_width, 0,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    sg_opengl_checkerror("SoftRenderer::present");
+}
+
+}
@@ -0,0 +1,116 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_SOFT_HPP
+#define LD_GRAPHICS_SOFT_HPP
+#include "bake.hpp"
+#include "mesh.hpp"
+#include "renderer.hpp"
+#include "sprite.hpp"
+#include "base/image.hpp"
+#include "sg/opengl.h"
+#include <cstdint>
+#include <vector>
+namespace Graphics {
+struct View;
+
+/// Renderer which draws on the CPU, into a pixel buffer.  It draws
+/// the terrain, sprites, and text box the same way the System does,
+/// so rendering can be measured and compared against reference images
+/// on machines without a GPU.
+///
+/// Triangles are transformed and sorted into screen tiles on the
+/// calling thread, then the tiles are rasterized in parallel on the
+/// worker threads, four pixels at a time with SSE2.  Attributes are
+/// interpolated in screen space, which matches OpenGL closely for
+/// this scene, where the terrain is small on screen and sprites face
+/// the camera.  The text itself is not drawn, since the glyphs only
+/// exist in an OpenGL texture.
+class SoftRenderer : public Renderer {
+public:
+    /// A triangle, ready for rasterization.  Each value is stored as
+    /// a plane equation, v = a*x + b*y + c, in window coordinates.
+    struct Triangle {
+        enum Kind {
+            /// Terrain: interpolated color, flat lighting.
+            TERRAIN,
+            /// Sprite: blended texture, with depth.
+            IMAGE,
+            /// Text box: alpha-tested texture, drawn on top.
+            OVERLAY
+        };
+
+        /// Edge functions, inside where edge >= threshold.
+        float edge[3][3];
+        float threshold[3];
+        /// Depth, from 0 to 1.
+        float depth[3];
+        /// Color or texture coordinates (in texels).
+        float attr[3][3];
+        /// Light for terrain, from the last vertex.
+        float light[3];
+        /// Bounding box, in pixels: x0, y0, x1, y1 (exclusive).
+        int bounds[4];
+        Kind kind;
+    };
+
+private:
+    bool m_present;
+
+    // Assets.
+    std::vector<BakedVertex> m_vertex;
+    std::vector<unsigned> m_index;
+    std::vector<MeshTile> m_tile;
+    int m_level_count;
+    Vec3 m_vertex_scale;
+    const Base::TextureData *m_atlas;
+    short m_textbox[4];
+    SpriteCache m_sprite_cache;
+
+    // Frame.
+    Base::Pixbuf m_color;
+    std::vector<float> m_depth;
+    int m_width, m_height, m_depth_stride;
+    std::vector<float> m_clip;
+    std::vector<unsigned> m_clip_stamp;
+    unsigned m_stamp;
+    std::vector<Triangle> m_tri;
+    std::vector<std::vector<unsigned>> m_bin;
+    int m_tiles_x, m_tiles_y;
+
+    // Presentation.
+    GLuint m_texture;
+    GLuint m_framebuffer;
+
+public:
+    /// Create a software renderer.  If present is true, each frame is
+    /// copied to the current OpenGL framebuffer after it is drawn.
+    /// Otherwise, OpenGL is not used at all.
+    explicit SoftRenderer(bool present);
+    SoftRenderer(const SoftRenderer &) = delete;
+    ~SoftRenderer() override;
+    SoftRenderer &operator=(const SoftRenderer &) = delete;
+
+    bool load(Game::Game &game, Resources &res) override;
+    void draw(int width, int height, const Game::Game &game) override;
+    void report_memory(Base::MemoryReport &report) const override;
+
+    /// Get the most recently drawn frame, RGBA, with the top row
+    /// first.
+    const Base::Pixbuf &pixels() const { return m_color; }
+
+private:
+    void resize(int width, int height);
+    void add_terrain(const View &v);
+    void add_sprites(const View &v, const Game::Game &game);
+    void add_overlay(const View &v, const Game::Game &game);
+    Triangle *add_triangle(const float (*pos)[4], const float (*attr)[3],
+                           Triangle::Kind kind, bool cull);
+    void bin_triangles();
+    void raster_tile(int tile);
+    void present();
+};
+
+}
+#endif
@@ -6,80 +6,203 @@
 #include "sprite.hpp"
 #include "sg/sprite.h"
 #include "base/chunk.hpp"
+#include "base/memory.hpp"
+#include "base/radix.hpp"
+#include "game/person.hpp"
+#include "game/sprite.hpp"
 #include <cstring>
 namespace Graphics {
 
-SpriteArray::SpriteArray()
-{ }
+namespace {
 
-SpriteArray::SpriteArray(SpriteArray &&other)
-    : m_array(std::move(other.m_array))
-{ }
+using Base::Orientation;
+typedef SpriteArray::Instance Instance;
 
-SpriteArray::~SpriteArray()
-{ }
+struct DirectionInfo {
+    int index;
+    Orientation orient;
+};
+
+const DirectionInfo DIRECTION_INFO[4] = {
+    { 1, Orientation::FLIP_HORIZONTAL },
+    { 2, Orientation::NORMAL },
+    { 1, Orientation::NORMAL },
+    { 0, Orientation::NORMAL },
+};
 
-SpriteArray &SpriteArray::operator=(SpriteArray &&other) {
-    m_array = std::move(other.m_array);
-    return *this;
 }
 
-void SpriteArray::clear() {
-    m_array.clear();
+const unsigned char SpriteArray::CORNER[PART_VERTEX_COUNT][2] = {
+    { 0, 0 }, { 1, 0 }, { 0, 1 },
+    { 0, 1 }, { 1, 0 }, { 1, 1 }
+};
+
+SpriteArray::SpriteArray()
+    : m_data(nullptr), m_count(0), m_alloc(0), m_copies(1)
+{ }
+
+void SpriteArray::begin(Instance *data, unsigned capacity, bool instanced) {
+    m_data = data;
+    m_count = 0;
+    m_alloc = capacity;
+    m_copies = instanced ? 1 : PART_VERTEX_COUNT;
 }
 
 void SpriteArray::add(const SpritePart *parts, int count,
                       Vec3 pos, Vec3 right, Vec3 up,
                       Base::Orientation orient) {
-    Vec3 nright, nup;
-
-    {
-        int oidx = static_cast<int>(orient);
-        Vec3 up2 = (oidx & 4) != 0 ? -up : up;
-        switch (oidx & 3) {
-        default:
-        case 0: nright =  right; nup =    up2; break;
-        case 1: nright =    up2; nup = -right; break;
-        case 2: nright = -right; nup =   -up2; break;
-        case 3: nright =   -up2; nup =  right; break;
-        }
-    }
-
-    Vertex *all_verts = m_array.insert(6 * count);
+    if ((unsigned) (m_copies * count) > m_alloc - m_count)
+        Log::abort("SpriteArray overflow");
+    Instance *out = m_data + m_count;
+    m_count += m_copies * count;
     for (int i = 0; i < count; i++) {
-        Vertex *v = all_verts + 6 * i;
         const auto sp = *parts[i].sprite;
+        Instance inst;
+        inst.pos = pos + parts[i].offset[0] * right +
+            parts[i].offset[1] * up;
+        inst.rect[0] = sp.x;
+        inst.rect[1] = sp.y;
+        inst.rect[2] = sp.w;
+        inst.rect[3] = sp.h;
+        inst.center[0] = sp.cx;
+        inst.center[1] = sp.cy;
+        inst.corner[0] = 0;
+        inst.corner[1] = 0;
+        inst.orient = (unsigned char) static_cast<int>(orient);
+        inst.pad = 0;
+        out = emit(out, inst);
+    }
+}
 
-        {
-            short tx0 = sp.x, tx1 = sp.x + sp.w;
-            short ty1 = sp.y, ty0 = sp.y + sp.h;
+void SpriteArray::add_people(SpriteCache &cache,
+                             const Game::SpriteData &sprites,
+                             const std::vector<Game::Person> &people,
+                             float frac, const Mat4 &worldview,
+                             Vec3 right, Vec3 up) {
+    std::size_t n = people.size();
+    if (!n) {
+        return;
+    }
+    m_pos.resize(n);
+    m_depth.resize(n);
+    m_key.resize(n);
+    m_order.resize(n);
+    m_temp.resize(n);
 
-            v[0].tx = tx0; v[0].ty = ty0;
-            v[1].tx = tx1; v[1].ty = ty0;
-            v[2].tx = tx0; v[2].ty = ty1;
-            v[3].tx = tx0; v[3].ty = ty1;
-            v[4].tx = tx1; v[4].ty = ty0;
-            v[5].tx = tx1; v[5].ty = ty1;
+    // Sort by distance along the view axis.  The depth is quantized
+    // to 16 bits over the range spanned by the people this frame.
+    // Cameras look down -Z, so the farthest people have the lowest Z.
+    float zmin = 0.0f, zmax = 0.0f;
+    for (std::size_t i = 0; i < n; i++) {
+        Vec3 pos = people[i].position(frac);
+        float z = worldview.m[0][2] * pos[0] + worldview.m[1][2] * pos[1] +
+            worldview.m[2][2] * pos[2] + worldview.m[3][2];
+        m_pos[i] = pos;
+        m_depth[i] = z;
+        if (!i || z < zmin) zmin = z;
+        if (!i || z > zmax) zmax = z;
+    }
+    float scale = zmax > zmin ? 65535.0f / (zmax - zmin) : 0.0f;
+    for (std::size_t i = 0; i < n; i++) {
+        m_key[i] = (std::uint16_t) ((m_depth[i] - zmin) * scale + 0.5f);
+    }
+    Base::radix_order(m_order.data(), m_temp.data(), m_key.data(), n);
+
+    for (std::size_t i = 0; i < n; i++) {
+        unsigned idx = m_order[i];
+        const auto &entry = cache.get(idx, sprites, people[idx]);
+        int count = entry.count;
+        if ((unsigned) (m_copies * count) > m_alloc - m_count)
+            Log::abort("SpriteArray overflow");
+        Instance *out = m_data + m_count;
+        m_count += m_copies * count;
+        Vec3 pos = m_pos[idx];
+        for (int j = 0; j < count; j++) {
+            Instance inst = entry.part[j];
+            inst.pos = pos + entry.offset[j][0] * right +
+                entry.offset[j][1] * up;
+            out = emit(out, inst);
         }
+    }
+}
+
+void SpriteArray::report_memory(Base::MemoryReport &report) const {
+    report.add("sprites", m_pos);
+    report.add("sprites", m_depth);
+    report.add("sprites", m_key);
+    report.add("sprites", m_order);
+    report.add("sprites", m_temp);
+}
 
-        {
-            Vec3 spos = pos +
-                parts[i].offset[0] * right + parts[i].offset[1] * up;
-            Vec3 vx0 = nright * (float) -sp.cx;
-            Vec3 vx1 = nright * (float) (sp.w - sp.cx);
-            Vec3 vy0 = nup * (float) (sp.cy - sp.h);
-            Vec3 vy1 = nup * (float) +sp.cy;
-
-            v[0].pos = spos + vx0 + vy0;
-            v[1].pos = v[4].pos = spos + vx1 + vy0;
-            v[2].pos = v[3].pos = spos + vx0 + vy1;
-            v[5].pos = spos + vx1 + vy1;
+SpriteArray::Instance *SpriteArray::emit(Instance *out, Instance inst)
+    const {
+    if (m_copies == 1) {
+        *out++ = inst;
+    } else {
+        for (int j = 0; j < PART_VERTEX_COUNT; j++) {
+            inst.corner[0] = CORNER[j][0];
+            inst.corner[1] = CORNER[j][1];
+            *out++ = inst;
         }
     }
+    return out;
+}
+
+SpriteCache::SpriteCache()
+    : m_compose_count(0)
+{ }
+
+void SpriteCache::clear() {
+    m_entry.clear();
+}
+
+const SpriteCache::Entry &SpriteCache::get(
+    std::size_t index, const Game::SpriteData &sprites,
+    const Game::Person &person) {
+    if (index >= m_entry.size()) {
+        Entry empty;
+        empty.appearance = 0;
+        empty.count = 0;
+        m_entry.resize(index + 1, empty);
+    }
+    Entry &e = m_entry[index];
+    if (e.appearance == person.appearance()) {
+        return e;
+    }
+    m_compose_count++;
+    e.appearance = person.appearance();
+    auto dir = DIRECTION_INFO[static_cast<int>(person.direction())];
+    int count = 0;
+    for (auto part : person.sprite()) {
+        const auto &sp = sprites.get_data(
+            part.sprite(), part.frame(), dir.index);
+        Instance &inst = e.part[count];
+        inst.pos = Vec3::zero();
+        inst.rect[0] = sp.x;
+        inst.rect[1] = sp.y;
+        inst.rect[2] = sp.w;
+        inst.rect[3] = sp.h;
+        inst.center[0] = sp.cx;
+        inst.center[1] = sp.cy;
+        inst.corner[0] = 0;
+        inst.corner[1] = 0;
+        inst.orient = (unsigned char) static_cast<int>(dir.orient);
+        inst.pad = 0;
+        e.offset[count] = part.offset();
+        count++;
+    }
+    e.count = count;
+    return e;
+}
+
+unsigned SpriteCache::take_compose_count() {
+    unsigned count = m_compose_count;
+    m_compose_count = 0;
+    return count;
 }
 
-void SpriteArray::upload(GLuint usage) {
-    m_array.upload(usage);
+void SpriteCache::report_memory(Base::MemoryReport &report) const {
+    report.add("sprites", m_entry);
 }
 
 }
@@ -9,9 +9,18 @@
 #include "base/file.hpp"
 #include "base/orientation.hpp"
 #include "base/image.hpp"
+#include "game/person.hpp"
+#include <cstdint>
 #include <vector>
 struct sg_sprite;
+namespace Base {
+class MemoryReport;
+}
+namespace Game {
+class SpriteData;
+}
 namespace Graphics {
+class SpriteCache;
 
 /// A part of a composite sprite.
 struct SpritePart {
@@ -19,40 +28,114 @@ struct SpritePart {
     Vec2 offset;
 };
 
-// Array of sprite rectangles with texture coordinates.
-// Draw with GL_TRIANGLES.
+// Array of sprite instances.  Each sprite part is stored as a single
+// record, which the vertex shader expands into a quad.  Draw with
+// GL_TRIANGLES, six vertexes per instance.
 class SpriteArray {
-private:
-    struct Vertex {
+public:
+    /// A single sprite part, 28 bytes.
+    struct Instance {
+        /// Position of the sprite's center point.
         Vec3 pos;
-        short tx, ty;
+        /// Texture rectangle: x, y, width, height.
+        short rect[4];
+        /// Center point, relative to the rectangle.
+        short center[2];
+        /// Quad corner (0 or 1 on each axis).  Only used when drawing
+        /// without instancing.
+        unsigned char corner[2];
+        /// Orientation, see Base::Orientation.
+        unsigned char orient;
+        unsigned char pad;
     };
 
-    Base::Array<Vertex> m_array;
+    /// The number of vertexes for each sprite part.
+    static const int PART_VERTEX_COUNT = 6;
+    /// The corner of each vertex of a sprite quad.
+    static const unsigned char CORNER[PART_VERTEX_COUNT][2];
+
+private:
+    Instance *m_data;
+    unsigned m_count;
+    unsigned m_alloc;
+    int m_copies;
+
+    // Scratch space for sorting people.  A typical scene fits in the
+    // inline storage and never touches the heap.
+    static const std::size_t SORT_INLINE = 64;
+    Base::Array<Vec3, SORT_INLINE> m_pos;
+    Base::Array<float, SORT_INLINE> m_depth;
+    Base::Array<std::uint16_t, SORT_INLINE> m_key;
+    Base::Array<unsigned, SORT_INLINE> m_order;
+    Base::Array<unsigned, SORT_INLINE> m_temp;
 
 public:
     SpriteArray();
     SpriteArray(const SpriteArray &other) = delete;
-    SpriteArray(SpriteArray &&other);
-    ~SpriteArray();
     SpriteArray &operator=(const SpriteArray &other) = delete;
-    SpriteArray &operator=(SpriteArray &&other);
 
-    /// Clear the array.
-    void clear();
+    /// Start writing to the given storage, which has space for the
+    /// given number of records.  If instanced is false, each part is
+    /// written once for each vertex, with the corner set.
+    void begin(Instance *data, unsigned capacity, bool instanced);
     /// Add sprites at the given location.
     void add(const SpritePart *parts, int count,
              Vec3 pos, Vec3 right, Vec3 up,
              Base::Orientation orient);
-    /// Upload the array data.
-    void upload(GLuint usage);
-    /// Bind the OpenGL attribute.
-    void set_attrib(GLint attrib);
-    /// Get the number of vertexes.
-    unsigned size() const { return m_array.size(); }
+    /// Add the sprites for a list of people, sorted from back to
+    /// front so they can be drawn with blending.  Each person's
+    /// records are taken from the cache, and only composed again if
+    /// the person's appearance changed.
+    void add_people(SpriteCache &cache, const Game::SpriteData &sprites,
+                    const std::vector<Game::Person> &people, float frac,
+                    const Mat4 &worldview, Vec3 right, Vec3 up);
+    /// Get the number of records.
+    unsigned size() const { return m_count; }
     /// Determine whether the array is empty.
-    bool empty() const { return m_array.empty(); }
+    bool empty() const { return m_count == 0; }
+    /// Add the memory used for sorting to a report.
+    void report_memory(Base::MemoryReport &report) const;
+
+private:
+    /// Write a record, once for each copy.
+    Instance *emit(Instance *out, Instance inst) const;
 };
 
+/// Composed sprite records for each person, indexed by the person's
+/// position in the game's list of people.  An entry is only rebuilt
+/// when the person's appearance number changes, so people standing
+/// still cost a copy per part each frame.
+class SpriteCache {
+public:
+    struct Entry {
+        /// The appearance number the records were composed for.
+        unsigned appearance;
+        /// Number of parts.
+        int count;
+        /// Records for each part, with the position set to zero.
+        SpriteArray::Instance part[Game::PART_COUNT];
+        /// Offset of each part, in sprite pixels.
+        Vec2 offset[Game::PART_COUNT];
+    };
+
+private:
+    std::vector<Entry> m_entry;
+    unsigned m_compose_count;
+
+public:
+    SpriteCache();
+    SpriteCache(const SpriteCache &other) = delete;
+    SpriteCache &operator=(const SpriteCache &other) = delete;
+
+    /// Discard all entries.  Call this when the sprite data changes.
+    void clear();
+    /// Get the records for a person, composing them if necessary.
+    const Entry &get(std::size_t index, const Game::SpriteData &sprites,
+                     const Game::Person &person);
+    /// Get the number of entries composed since the last call.
+    unsigned take_compose_count();
+    /// Add the memory used to a report.
+    void report_memory(Base::MemoryReport &report) const;
+};
 }
 #endif
@@ -0,0 +1,146 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "state.hpp"
+namespace Graphics {
+
+namespace {
+
+/// Value for state which is not known.
+const GLuint UNKNOWN = (GLuint) -1;
+
+}
+
+State::State() {
+    invalidate();
+    begin_frame();
+}
+
+void State::begin_frame() {
+    m_counters.changes = 0;
+    m_counters.skipped = 0;
+    m_counters.draws = 0;
+}
+
+void State::end_frame() {
+    use_program(0);
+    bind_vertex_array(0);
+}
+
+void State::invalidate() {
+    m_program = UNKNOWN;
+    m_array = UNKNOWN;
+    invalidate_textures();
+    m_depth_test = -1;
+    m_cull_face = -1;
+    m_blend = -1;
+    m_depth_func = UNKNOWN;
+    m_depth_range[0] = -1.0f;
+    m_depth_range[1] = -1.0f;
+    m_blend_func[0] = UNKNOWN;
+    m_blend_func[1] = UNKNOWN;
+}
+
+void State::invalidate_textures() {
+    m_active_texture = -1;
+    for (int i = 0; i < TEXTURE_UNITS; i++)
+        m_texture[i] = UNKNOWN;
+}
+
+bool State::changed(bool differs) {
+    if (differs)
+        m_counters.changes++;
+    else
+        m_counters.skipped++;
+    return differs;
+}
+
+void State::set_cap(signed char &cache, GLenum cap, bool enable) {
+    if (!changed(cache != (signed char) enable))
+        return;
+    cache = enable;
+    if (enable)
+        glEnable(cap);
+    else
+        glDisable(cap);
+}
+
+void State::use_program(GLuint program) {
+    if (!changed(m_program != program))
+        return;
+    m_program = program;
+    glUseProgram(program);
+}
+
+void State::bind_vertex_array(GLuint array) {
+    if (!changed(m_array != array))
+        return;
+    m_array = array;
+    glBindVertexArray(array);
+}
+
+void State::bind_texture(int unit, GLuint texture) {
+    if (!changed(m_texture[unit] != texture))
+        return;
+    if (m_active_texture != unit) {
+        m_active_texture = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    m_texture[unit] = texture;
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void State::set_depth_test(bool enable) {
+    set_cap(m_depth_test, GL_DEPTH_TEST, enable);
+}
+
+void State::set_cull_face(bool enable) {
+    set_cap(m_cull_face, GL_CULL_FACE, enable);
+}
+
+void State::set_blend(bool enable) {
+    set_cap(m_blend, GL_BLEND, enable);
+}
+
+void State::depth_func(GLenum func) {
+    if (!changed(m_depth_func != func))
+        return;
+    m_depth_func = func;
+    glDepthFunc(func);
+}
+
+void State::depth_range(float near, float far) {
+    if (!changed(m_depth_range[0] != near || m_depth_range[1] != far))
+        return;
+    m_depth_range[0] = near;
+    m_depth_range[1] = far;
+    glDepthRange(near, far);
+}
+
+void State::blend_func(GLenum sfactor, GLenum dfactor) {
+    if (!changed(m_blend_func[0] != sfactor || m_blend_func[1] != dfactor))
+        return;
+    m_blend_func[0] = sfactor;
+    m_blend_func[1] = dfactor;
+    glBlendFunc(sfactor, dfactor);
+}
+
+void State::draw_arrays(GLenum mode, GLint first, GLsizei count) {
+    m_counters.draws++;
+    glDrawArrays(mode, first, count);
+}
+
+void State::draw_arrays_instanced(GLenum mode, GLint first, GLsizei count,
+                                  GLsizei instances) {
+    m_counters.draws++;
+    glDrawArraysInstanced(mode, first, count, instances);
+}
+
+void State::draw_elements(GLenum mode, GLsizei count, GLenum type,
+                          std::size_t offset) {
+    m_counters.draws++;
+    glDrawElements(mode, count, type, reinterpret_cast<void *>(offset));
+}
+
+}
@@ -0,0 +1,84 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_STATE_HPP
+#define LD_GRAPHICS_STATE_HPP
+#include "sg/opengl.h"
+#include <cstddef>
+namespace Graphics {
+
+/// Cache of OpenGL state.  Subsystems set the state they need before
+/// drawing, and calls which would not change anything are skipped.
+/// The cache carries over from one frame to the next.  Only the state
+/// set through this object is tracked, so the cache must be
+/// invalidated when the context is created, or when anything else
+/// might have changed the state.
+class State {
+public:
+    static const int TEXTURE_UNITS = 4;
+
+    /// Statistics for the current frame.
+    struct Counters {
+        /// Number of state changes sent to OpenGL.
+        unsigned changes;
+        /// Number of state changes skipped.
+        unsigned skipped;
+        /// Number of draw calls.
+        unsigned draws;
+    };
+
+private:
+    GLuint m_program;
+    GLuint m_array;
+    int m_active_texture;
+    GLuint m_texture[TEXTURE_UNITS];
+    signed char m_depth_test;
+    signed char m_cull_face;
+    signed char m_blend;
+    GLenum m_depth_func;
+    float m_depth_range[2];
+    GLenum m_blend_func[2];
+    Counters m_counters;
+
+public:
+    State();
+    State(const State &) = delete;
+    State &operator=(const State &) = delete;
+
+    /// Start a new frame, resetting the counters.
+    void begin_frame();
+    /// Finish a frame.  The program and vertex array are unbound, so
+    /// they do not leak into drawing done outside this system.
+    void end_frame();
+    /// Forget the cached state.
+    void invalidate();
+    /// Forget the cached texture bindings.
+    void invalidate_textures();
+    /// Get the statistics for the current frame.
+    const Counters &counters() const { return m_counters; }
+
+    void use_program(GLuint program);
+    void bind_vertex_array(GLuint array);
+    /// Bind a 2D texture to a texture unit.
+    void bind_texture(int unit, GLuint texture);
+    void set_depth_test(bool enable);
+    void set_cull_face(bool enable);
+    void set_blend(bool enable);
+    void depth_func(GLenum func);
+    void depth_range(float near, float far);
+    void blend_func(GLenum sfactor, GLenum dfactor);
+
+    void draw_arrays(GLenum mode, GLint first, GLsizei count);
+    void draw_arrays_instanced(GLenum mode, GLint first, GLsizei count,
+                               GLsizei instances);
+    void draw_elements(GLenum mode, GLsizei count, GLenum type,
+                       std::size_t offset);
+
+private:
+    bool changed(bool differs);
+    void set_cap(signed char &cache, GLenum cap, bool enable);
+};
+
+}
+#endif
@@ -4,479 +4,423 @@
    information, see LICENSE.txt. */
 #include "defs.hpp"
 #include "system.hpp"
+#include "bake.hpp"
+#include "frustum.hpp"
+#include "mesh.hpp"
+#include "resources.hpp"
+#include "state.hpp"
+#include "terrain.hpp"
+#include "text.hpp"
 #include "transform.hpp"
+#include "uniforms.hpp"
+#include "view.hpp"
 #include "color.hpp"
 #include "game/game.hpp"
 #include "game/person.hpp"
 #include "base/image.hpp"
+#include "base/memory.hpp"
+#include "base/stream.hpp"
+#include "base/timer.hpp"
+#include <cstddef>
 #include <cstring>
 namespace Graphics {
 
 namespace {
 
 const bool debug_trace = false;
+/// Whether to log the number of draw calls and state changes.
+const bool debug_stats = false;
 const float FONT_SIZE = 48.0f;
-const float BOX_SIZE = 1024.0f;
 const Vec2 TEXT_POS {{ -425.0f, 325.0f }};
 const int TEXT_PALETTE[3] = { 21, 23, 8 };
+/// Number of laid out lines of text to keep.
+const std::size_t TEXT_CACHE_SIZE = 256;
+/// Whether to lay out all of the script's text ahead of time.
+const bool TEXT_PREWARM = true;
+/// Whether to draw sprites with alpha blending.  Sprites are always
+/// sorted from back to front, so blending is correct between them.
+const bool SPRITE_BLEND = true;
 
 using Base::Orientation;
 
-struct DirectionInfo {
-    int index;
-    Orientation orient;
-};
-
-const DirectionInfo DIRECTION_INFO[4] = {
-    { 1, Orientation::FLIP_HORIZONTAL },
-    { 2, Orientation::NORMAL },
-    { 1, Orientation::NORMAL },
-    { 0, Orientation::NORMAL },
-};
-
-const int LIGHT_COUNT = 4;
-const float LIGHT_DIR[LIGHT_COUNT][3] = {
-    { 0.0f, 0.0f, 1.0f },
-    { 0.0f, 1.0f, 0.0f },
-    { 1.0f, 0.0f, 0.0f },
-    {-1.0f, 0.0f, 0.0f }
-};
-const float LIGHT_COLOR[LIGHT_COUNT][3] = {
-    { 0.5f, 0.5f, 0.5f },
-    { 1.0f, 0.5f, 0.5f },
-    { 0.5f, 1.0f, 0.5f },
-    { 0.5f, 0.5f, 1.0f }
-};
-
-const float SPRITE_SCALE = 0.2f;
-
-struct FrameData {
-    const Game::Game &game;
-    int width, height;
-    Mat4 projection;
-    Mat4 worldview;
-    Quat camera_angle;
-    float pixscale;
-
-    FrameData(int width, int height, const Game::Game &game);
-};
-
-FrameData::FrameData(int width, int height, const Game::Game &game)
-    : game(game), width(width), height(height) {
-    // Reference aspect ratio.
-    const double ref_aspect = 16.0 / 9.0, inv_ref_aspect = 9.0 / 16.0;
-    // 35mm equivalent focal length.
-    const double focal = 55.0;
-    // Width of the subject.
-    const double subject_size = 64.0 * 1.4;
-
-    double distance;
-
-    {
-        // We pretend that we are using a 16:9 aspect ratio.
-        double xratio = 18.0 / focal;
-        double yratio = xratio * inv_ref_aspect;
-        distance = 0.5 * subject_size / xratio;
-
-        // Then we expand the FOV to match the actual aspect ratio.
-        double aspect = (double) width / (double) height;
-        if (aspect > ref_aspect) {
-            xratio = yratio * aspect;
-            pixscale = (float) height * (1.0f / 1080.0f);
-        } else {
-            yratio = xratio / aspect;
-            pixscale = (float) width * (1.0f / 1920.0f);
-        }
-
-        projection = Mat4::perspective(
-            (float) xratio,
-            (float) yratio,
-            std::max(1.0f, (float) (distance - 0.5 * subject_size)),
-            (float) (distance + 0.5 * subject_size));
-    }
-
-    // View angle.
-    const double azimuth = 180.0;
-    const double elevation = 40.0;
-
-    {
-        camera_angle =
-            Quat::rotation(
-                Vec3{{0.0f, 0.0f, 1.0f}},
-                (std::atan(1.0) / 45.0) * (180.0 - azimuth)) *
-            Quat::rotation(
-                Vec3{{1.0f, 0.0f, 0.0f}},
-                (std::atan(1.0) / 45.0) * (90.0 - elevation));
-        Vec3 target {{ 0.0f, 0.0f, 2.0f }};
-        Vec3 dir = camera_angle.transform(Vec3{{0.0f, 0.0f, 1.0f}});
-        Vec3 pos = target + dir * (float) distance;
-        worldview = Mat4::rotation(camera_angle.conjugate()) *
-            Mat4::translation(-pos);
-    }
-}
-
-}
-
-// ======================================================================
-// User interface
-// ======================================================================
-
-class System::SysUi {
-private:
-    unsigned m_serial;
-    bool m_visible;
-    Base::Texture m_textbox;
-    Base::Program<Shader::Ui> m_prog;
-    GLuint m_buffer;
-    GLuint m_array;
 
-public:
-    SysUi();
-    SysUi(const SysUi &) = delete;
-    ~SysUi();
-    SysUi &operator=(const SysUi &) = delete;
-
-    bool load(const Game::Game &game);
-    void draw(const FrameData &f);
-
-public:
-    void update(const FrameData &f);
-};
-
-System::SysUi::SysUi()
-    : m_serial(0xffffffff),
-      m_visible(false),
-      m_buffer(0),
-      m_array(0) {}
-
-System::SysUi::~SysUi() {
-    glDeleteBuffers(1, &m_buffer);
-    glDeleteVertexArrays(1, &m_buffer);
-}
-
-bool System::SysUi::load(const Game::Game &game) {
-    (void) &game;
-    bool success = true;
-
-    if (!m_textbox.load("image/textbox")) {
-        success = false;
-    } else {
-        glBindTexture(GL_TEXTURE_2D, m_textbox.tex);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glBindTexture(GL_TEXTURE_2D, 0);
+/// Whether to draw terrain with precomputed lighting.  Otherwise,
+/// lighting is calculated in the vertex shader each frame.
+const bool TERRAIN_BAKED = true;
+
+/// Get the contents of the "World" uniform block.
+Uniforms::World world_uniforms(Vec3 scale) {
+    static_assert(TERRAIN_LIGHT_COUNT == Uniforms::LIGHT_COUNT,
+                  "light count must match shaders");
+    TerrainLighting lighting = terrain_lighting(scale);
+    Uniforms::World u;
+    std::memset(&u, 0, sizeof(u));
+    for (int i = 0; i < 3; i++) {
+        u.vertex_scale[i] = scale[i];
+        u.normalmat[i][i] = 1.0f;
     }
-
-    if (!m_prog.load("ui", "ui")) {
-        success = false;
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 4; j++)
+            u.terrain_color[i][j] = lighting.terrain_color[i].v[j];
     }
-    glDeleteBuffers(1, &m_buffer);
-    glDeleteVertexArrays(1, &m_array);
-
-    if (m_prog.is_loaded()) {
-        glGenBuffers(1, &m_buffer);
-        glGenVertexArrays(1, &m_array);
-        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-        glBindVertexArray(m_array);
-        // glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
-        if (m_prog->a_vert >= 0) {
-            glEnableVertexAttribArray(m_prog->a_vert);
-            glVertexAttribPointer(
-                m_prog->a_vert, 4, GL_FLOAT, GL_FALSE,
-                0, reinterpret_cast<void *>(0));
+    for (int i = 0; i < TERRAIN_LIGHT_COUNT; i++) {
+        for (int j = 0; j < 3; j++) {
+            u.light_dir[i][j] = lighting.light_dir[i][j];
+            u.light_color[i][j] = lighting.light_color[i][j];
         }
     }
-
-    sg_opengl_checkerror("SysUi::load");
-    return success;
+    return u;
 }
 
-void System::SysUi::draw(const Graphics::FrameData &f) {
-    if (!m_prog.is_loaded()) {
-        return;
-    }
-    update(f);
-    if (!m_visible) {
-        return;
-    }
-
-    glUseProgram(m_prog.prog());
-    glBindVertexArray(m_array);
-    glUniform1i(m_prog->u_texture, 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_textbox.tex);
+/// Bytes of streaming vertex data expected per frame.
+const std::size_t STREAM_SIZE = 1u << 18;
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_ALWAYS);
-    glDepthRange(0.0, 0.0);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glDepthFunc(GL_LESS);
-    glDepthRange(0.0, 1.0);
-
-    sg_opengl_checkerror("SysUi::draw");
-}
-
-void System::SysUi::update(const Graphics::FrameData &f) {
-    const auto &vm = f.game.machine();
-    if (m_serial == vm.text_serial()) {
-        return;
-    }
-    m_serial = vm.text_serial();
-    m_visible = !f.game.machine().text().empty();
-    if (!m_visible) {
-        return;
-    }
-
-    Vec2 vertscale { 2.0f / (float) f.width, 2.0f / (float) f.height };
-    float boxsize = BOX_SIZE * f.pixscale;
-    float x0 = -0.5f * boxsize * vertscale[0];
-    float x1 = +0.5f * boxsize * vertscale[0];
-    float y0 = -1.0f;
-    float y1 = -1.0f + vertscale[1] * boxsize * 0.5f;
-    float vert[24] = {
-        x0, y0, 0.0f, 1.0f,
-        x1, y0, 1.0f, 1.0f,
-        x0, y1, 0.0f, 0.0f,
-        x0, y1, 0.0f, 0.0f,
-        x1, y0, 1.0f, 1.0f,
-        x1, y1, 1.0f, 0.0f
-    };
-    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vert), vert, GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+/// Everything needed to draw a frame with OpenGL.
+struct FrameData : View {
+    const Game::Game &game;
+    Base::StreamBuffer &stream;
+    State &state;
+    /// Texture with the sprites and the text box.
+    const Base::Texture &atlas;
+
+    FrameData(int width, int height, const Game::Game &game,
+              Base::StreamBuffer &stream, State &state,
+              const Base::Texture &atlas)
+        : View(width, height), game(game), stream(stream), state(state),
+          atlas(atlas) {}
+};
 
-    sg_opengl_checkerror("SysUi::update");
 }
 
 // ======================================================================
-// Text
+// Overlay
 // ======================================================================
 
-class System::SysText {
+/// The text box and the text in it, drawn from one vertex stream.
+/// Everything except the font texture is batched together, so it takes
+/// one draw call for the box and one for all of the text.
+class System::SysOverlay {
 private:
-    struct Batch {
-        int line;
+    struct Vertex {
+        float pos[2];
+        float texcoord[2];
+        unsigned char color[4];
+        // 0 for images, 255 for text.
+        unsigned char mode;
+        unsigned char pad[3];
+    };
+
+    struct Line {
+        std::shared_ptr<const TextLayout> layout;
         float vertxform[4];
-        int offset;
-        int count;
     };
 
+    short m_textbox[4];
     sg_typeface *m_typeface;
-    sg_font *m_font;
+    std::string m_charset;
+    TextCache m_cache;
     unsigned m_serial;
-    std::vector<Batch> m_batch;
+    bool m_visible;
+    std::vector<Line> m_line;
 
-    Base::Program<Shader::Text> m_prog;
-    GLuint m_buffer;
+    Base::Program<Shader::Overlay> m_prog;
     GLuint m_array;
+    unsigned m_generation;
 
 public:
-    SysText();
-    SysText(const SysText &) = delete;
-    ~SysText();
-    SysText &operator=(const SysText &) = delete;
+    SysOverlay();
+    SysOverlay(const SysOverlay &) = delete;
+    ~SysOverlay();
+    SysOverlay &operator=(const SysOverlay &) = delete;
 
-    bool load(const Game::Game &game);
+    bool load(const Game::Game &game, const Resources &res);
     void draw(const FrameData &f);
+    /// Wait for the font to be rasterized, and upload it.
+    void upload_font();
+    void report_memory(Base::MemoryReport &report) const;
 
 private:
     void update(const FrameData &f);
+    void load_font(const Game::Game &game, float pixscale);
+    void set_attrib(const FrameData &f);
 };
 
-System::SysText::SysText()
+System::SysOverlay::SysOverlay()
     : m_typeface(nullptr),
-      m_font(nullptr),
+      m_cache(TEXT_CACHE_SIZE),
       m_serial(0xffffffff),
-      m_buffer(0),
-      m_array(0) {}
+      m_visible(false),
+      m_array(0),
+      m_generation(0xffffffff) {
+    for (int i = 0; i < 4; i++) {
+        m_textbox[i] = 0;
+    }
+}
 
-System::SysText::~SysText() {
-    glDeleteBuffers(1, &m_buffer);
+System::SysOverlay::~SysOverlay() {
+    // Release the font before the typeface.
+    m_cache.set_font(nullptr, 0.0f);
+    if (m_typeface) {
+        sg_typeface_decref(m_typeface);
+    }
     glDeleteVertexArrays(1, &m_array);
 }
 
-bool System::SysText::load(const Game::Game &game) {
-    (void) &game;
+bool System::SysOverlay::load(const Game::Game &game,
+                              const Resources &res) {
     bool success = true;
 
-    const char *path = "font/Alegreya-Bold";
-    auto typeface = sg_typeface_file(path, std::strlen(path), nullptr);
-    if (typeface == nullptr) {
+    for (int i = 0; i < 4; i++) {
+        m_textbox[i] = res.textbox_rect[i];
+    }
+
+    if (res.typeface == nullptr) {
         success = false;
     } else {
+        sg_typeface_incref(res.typeface);
         if (m_typeface) {
             sg_typeface_decref(m_typeface);
         }
-        m_typeface = typeface;
+        m_typeface = res.typeface;
     }
 
-    if (!m_prog.load("text", "text")) {
+    // The window size is not known yet, so the font is created for
+    // the reference size.  The first frame creates it again at the
+    // real size if that is different.
+    m_charset = res.charset;
+    load_font(game, 1.0f);
+
+    if (!m_prog.load(res.prog_overlay)) {
         success = false;
     }
-    glDeleteBuffers(1, &m_buffer);
     glDeleteVertexArrays(1, &m_array);
+    m_array = 0;
+    m_generation = 0xffffffff;
 
     if (m_prog.is_loaded()) {
-        glGenBuffers(1, &m_buffer);
         glGenVertexArrays(1, &m_array);
-        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-        glBindVertexArray(m_array);
-        if (m_prog->a_vert >= 0) {
-            glEnableVertexAttribArray(m_prog->a_vert);
-            glVertexAttribPointer(
-                m_prog->a_vert, 4, GL_SHORT, GL_FALSE,
-                0, reinterpret_cast<void *>(0));
-        }
     }
 
-    sg_opengl_checkerror("SysText::load");
+    sg_opengl_checkerror("SysOverlay::load");
     return success;
 }
 
-void System::SysText::draw(const Graphics::FrameData &f) {
+void System::SysOverlay::draw(const Graphics::FrameData &f) {
     if (!m_prog.is_loaded()) {
         return;
     }
+    // Check the size every frame, not just when the text changes, so
+    // the font is rasterized in the background after a resize instead
+    // of when the next dialog appears.  Existing layouts use the old
+    // font, so they are laid out again.
+    if (m_typeface && m_cache.font_size() != FONT_SIZE * f.pixscale) {
+        load_font(f.game, f.pixscale);
+        m_serial = f.game.machine().text_serial() - 1;
+    }
     update(f);
-    if (m_batch.empty()) {
+    if (!m_visible) {
         return;
     }
 
-    GLuint texture;
+    GLuint font_texture;
     float texscale[2];
-    sg_font_gettexture(m_font, &texture, texscale);
-    glUseProgram(m_prog.prog());
-    glBindVertexArray(m_array);
-    glUniform2fv(m_prog->u_texscale, 1, texscale);
-    glUniform1i(m_prog->u_texture, 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    m_cache.get_texture(&font_texture, texscale);
+    // New glyphs are uploaded by binding the font texture.
+    f.state.invalidate_textures();
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_ALWAYS);
-    glDepthRange(0.0, 0.0);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    std::size_t count = 6;
+    for (const auto &line : m_line) {
+        count += line.layout->vert.size();
+    }
+    Vertex *vert = f.stream.reserve<Vertex>(count), *vp = vert;
 
+    {
+        float rect[4];
+        f.textbox(rect);
+        float x0 = rect[0], y0 = rect[1], x1 = rect[2], y1 = rect[3];
+        const float *texscale = f.atlas.scale;
+        float u0 = (float) m_textbox[0] * texscale[0];
+        float v0 = (float) m_textbox[1] * texscale[1];
+        float u1 = (float) (m_textbox[0] + m_textbox[2]) * texscale[0];
+        float v1 = (float) (m_textbox[1] + m_textbox[3]) * texscale[1];
+        const float box[6][4] = {
+            { x0, y0, u0, v1 },
+            { x1, y0, u1, v1 },
+            { x0, y1, u0, v0 },
+            { x0, y1, u0, v0 },
+            { x1, y0, u1, v1 },
+            { x1, y1, u1, v0 }
+        };
+        for (const auto &b : box) {
+            Vertex &v = *vp++;
+            v.pos[0] = b[0];
+            v.pos[1] = b[1];
+            v.texcoord[0] = b[2];
+            v.texcoord[1] = b[3];
+            for (int i = 0; i < 4; i++) {
+                v.color[i] = 255;
+            }
+            v.mode = 0;
+        }
+    }
+
+    // Colors are set every frame, since the selected line changes
+    // without changing the text.
     const auto &text = f.game.machine().text();
-    for (const auto &batch : m_batch) {
-        Color color = Color::palette(TEXT_PALETTE[text[batch.line].state]);
-        glUniform4fv(m_prog->u_color, 1, color.v);
-        glUniform4fv(m_prog->u_vertxform, 1, batch.vertxform);
-        glDrawArrays(GL_TRIANGLES, batch.offset, batch.count);
+    for (int i = 0, n = (int) m_line.size(); i < n; i++) {
+        const auto &line = m_line[i];
+        Color color = Color::palette(TEXT_PALETTE[text[i].state]);
+        unsigned char c[4];
+        for (int j = 0; j < 4; j++) {
+            float x = color.v[j] * 255.0f + 0.5f;
+            c[j] = (unsigned char) std::max(0.0f, std::min(255.0f, x));
+        }
+        const float *xf = line.vertxform;
+        for (const auto &tv : line.layout->vert) {
+            Vertex &v = *vp++;
+            v.pos[0] = (float) tv.x * xf[0] + xf[2];
+            v.pos[1] = (float) tv.y * xf[1] + xf[3];
+            v.texcoord[0] = (float) tv.u * texscale[0];
+            v.texcoord[1] = (float) tv.v * texscale[1];
+            for (int j = 0; j < 4; j++) {
+                v.color[j] = c[j];
+            }
+            v.mode = 255;
+        }
     }
+    GLint first = f.stream.commit(count);
+
+    f.state.use_program(m_prog.prog());
+    f.state.bind_vertex_array(m_array);
+    set_attrib(f);
+    glUniform1i(m_prog->u_texture, 0);
 
-    glDepthFunc(GL_LESS);
-    glDepthRange(0.0, 1.0);
-    glDisable(GL_BLEND);
+    f.state.set_depth_test(true);
+    f.state.set_cull_face(false);
+    f.state.set_blend(true);
+    f.state.depth_func(GL_ALWAYS);
+    f.state.depth_range(0.0f, 0.0f);
+    f.state.blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    f.state.bind_texture(0, f.atlas.tex);
+    f.state.draw_arrays(GL_TRIANGLES, first, 6);
+    if (count > 6) {
+        f.state.bind_texture(0, font_texture);
+        f.state.draw_arrays(GL_TRIANGLES, first + 6, (GLsizei) (count - 6));
+    }
 
-    sg_opengl_checkerror("SysText::draw");
+    sg_opengl_checkerror("SysOverlay::draw");
 }
 
-struct Batch {
-        int line;
-        float vertxform[4];
-        float color[4];
-        int offset;
-        int count;
-    };
+void System::SysOverlay::set_attrib(const Graphics::FrameData &f) {
+    if (m_generation == f.stream.generation()) {
+        return;
+    }
+    m_generation = f.stream.generation();
+    const GLsizei stride = sizeof(Vertex);
+    glBindBuffer(GL_ARRAY_BUFFER, f.stream.buffer());
+    if (m_prog->a_pos >= 0) {
+        glEnableVertexAttribArray(m_prog->a_pos);
+        glVertexAttribPointer(
+            m_prog->a_pos, 2, GL_FLOAT, GL_FALSE, stride,
+            reinterpret_cast<void *>(offsetof(Vertex, pos)));
+    }
+    if (m_prog->a_texcoord >= 0) {
+        glEnableVertexAttribArray(m_prog->a_texcoord);
+        glVertexAttribPointer(
+            m_prog->a_texcoord, 2, GL_FLOAT, GL_FALSE, stride,
+            reinterpret_cast<void *>(offsetof(Vertex, texcoord)));
+    }
+    if (m_prog->a_color >= 0) {
+        glEnableVertexAttribArray(m_prog->a_color);
+        glVertexAttribPointer(
+            m_prog->a_color, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+            reinterpret_cast<void *>(offsetof(Vertex, color)));
+    }
+    if (m_prog->a_mode >= 0) {
+        glEnableVertexAttribArray(m_prog->a_mode);
+        glVertexAttribPointer(
+            m_prog->a_mode, 1, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+            reinterpret_cast<void *>(offsetof(Vertex, mode)));
+    }
+}
 
-void System::SysText::update(const Graphics::FrameData &f) {
+void System::SysOverlay::update(const Graphics::FrameData &f) {
     const auto &vm = f.game.machine();
     if (m_serial == vm.text_serial()) {
         return;
     }
     m_serial = vm.text_serial();
     const auto &text = vm.text();
-
-    bool load_font = !m_font && !text.empty();
-    if (load_font) {
-        auto font = sg_font_new(
-            m_typeface, FONT_SIZE * f.pixscale, nullptr);
-        if (m_font) {
-            sg_font_decref(m_font);
-        }
-        m_font = font;
-    }
-
-    std::vector<sg_textlayout> layouts;
-    layouts.reserve(text.size());
-    int vertcount = 0, batchcount = 0;
-    for (const auto &line : text) {
-        auto flow = sg_textflow_new(nullptr);
-        if (!flow) {
-            break;
-        }
-        sg_textflow_setfont(flow, m_font);
-        sg_textflow_setwidth(flow, -2.0f * TEXT_POS[0] * f.pixscale);
-        sg_textflow_addtext(flow, line.text, std::strlen(line.text));
-
-        sg_textlayout layout;
-        int r = sg_textlayout_create(&layout, flow, nullptr);
-        sg_textflow_free(flow);
-        if (r) {
+    m_visible = !text.empty();
+    float width = -2.0f * TEXT_POS[0] * f.pixscale;
+
+    m_line.clear();
+    Vec2 vertscale { 2.0f / f.width, 2.0f / f.height };
+    Vec2 pos = TEXT_POS * f.pixscale;
+    for (const auto &tline : text) {
+        Line line;
+        line.layout = m_cache.get(tline.text, width);
+        if (!line.layout) {
             break;
         }
+        const auto &m = line.layout->metrics;
+        Vec2 lpos = pos;
+        lpos[0] -= (float) m.logical.x0;
+        lpos[1] -= (float) m.logical.y1;
+        line.vertxform[0] = vertscale[0];
+        line.vertxform[1] = vertscale[1];
+        line.vertxform[2] = lpos[0] * vertscale[0];
+        line.vertxform[3] = lpos[1] * vertscale[1] - 1.0f;
+        m_line.push_back(line);
+        pos[1] -= (float) (m.logical.y1 - m.logical.y0);
+    }
+}
 
-        vertcount += layout.vertcount;
-        batchcount += layout.batchcount;
-        layouts.push_back(layout);
-    }
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        vertcount * sizeof(sg_textvert),
-        nullptr,
-        GL_STATIC_DRAW);
-    m_batch.clear();
-    int vertoffset = 0;
-    if (vertcount > 0) {
-        m_batch.reserve(batchcount);
-        Vec2 vertscale { 2.0f / f.width, 2.0f / f.height };
-        Vec2 pos = TEXT_POS * f.pixscale;
-        for (int i = 0, n = (int) layouts.size(); i < n; i++) {
-            const auto &layout = layouts[i];
-            glBufferSubData(
-                GL_ARRAY_BUFFER,
-                vertoffset * sizeof(sg_textvert),
-                layout.vertcount * sizeof(sg_textvert),
-                layout.vert);
-
-            const auto &m = layout.metrics;
-            Vec2 lpos = pos;
-            lpos[0] -= (float) m.logical.x0;
-            lpos[1] -= (float) m.logical.y1;
-            float vertxform[4] = {
-                vertscale[0],
-                vertscale[1],
-                lpos[0] * vertscale[0],
-                lpos[1] * vertscale[1] - 1.0f
-            };
-
-            for (int j = 0, m = layout.batchcount; j < m; j++) {
-                const auto &ib = layout.batch[j];
-                Batch ob;
-                ob.line = i;
-                for (int k = 0; k < 4; k++) {
-                    ob.vertxform[k] = vertxform[k];
-                }
-                ob.offset = vertoffset + ib.offset;
-                ob.count = ib.count;
-                m_batch.push_back(ob);
-            }
-
-            pos[1] -= (float) (m.logical.y1 - m.logical.y0);
-            vertoffset += layout.vertcount;
-        }
+void System::SysOverlay::load_font(const Game::Game &game, float pixscale) {
+    if (!m_typeface) {
+        return;
     }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    float size = FONT_SIZE * pixscale;
+    auto font = sg_font_new(m_typeface, size, nullptr);
+    if (!font) {
+        return;
+    }
+    m_cache.set_font(font, size);
+    sg_font_decref(font);
+
+    // Laying out the whole character set rasterizes every glyph the
+    // script uses.  This runs on a worker thread, while the rest of
+    // the graphics system loads.
+    float width = -2.0f * TEXT_POS[0] * pixscale;
+    std::vector<const char *> text;
+    if (!m_charset.empty()) {
+        text.push_back(m_charset.c_str());
+    }
+    if (TEXT_PREWARM) {
+        auto dialog = game.machine().dialog_text();
+        text.insert(text.end(), dialog.begin(), dialog.end());
+    }
+    m_cache.prewarm(std::move(text), width);
+}
 
-    for (auto &layout : layouts) {
-        sg_textlayout_destroy(&layout);
+void System::SysOverlay::upload_font() {
+    if (!m_cache.has_font()) {
+        return;
     }
+    // Only the character set is needed for the texture, the dialog
+    // keeps laying out in the background.
+    m_cache.wait(m_charset.empty() ? 0 : 1);
+    GLuint texture;
+    float texscale[2];
+    m_cache.get_texture(&texture, texscale);
+    sg_opengl_checkerror("SysOverlay::upload_font");
+}
 
-    sg_opengl_checkerror("SysText::update");
+void System::SysOverlay::report_memory(Base::MemoryReport &report) const {
+    m_cache.report_memory(report);
+    report.add("text", m_charset);
+    report.add("text", m_line);
 }
 
 // ======================================================================
@@ -486,9 +430,15 @@ void System::SysText::update(const Graphics::FrameData &f) {
 class System::SysWorld {
 private:
     Base::Program<Shader::World> m_prog;
+    Base::Program<Shader::WorldBaked> m_prog_baked;
     GLuint m_buffer;
+    GLuint m_index_buffer;
     GLuint m_array;
-    GLsizei m_count;
+    GLenum m_index_type;
+    std::size_t m_index_size;
+    std::vector<MeshTile> m_tile;
+    int m_level_count;
+    std::size_t m_buffer_size;
 
 public:
     SysWorld();
@@ -496,38 +446,90 @@ public:
     ~SysWorld();
     SysWorld &operator=(const SysWorld) = delete;
 
-    bool load(const Game::Game &game);
+    bool load(const Game::Game &game, const Resources &res);
     void draw(const FrameData &f);
+    void report_memory(Base::MemoryReport &report) const;
 };
 
 System::SysWorld::SysWorld()
     : m_buffer(0),
+      m_index_buffer(0),
       m_array(0),
-      m_count(0) {}
+      m_index_type(GL_UNSIGNED_SHORT),
+      m_index_size(2),
+      m_level_count(1),
+      m_buffer_size(0) {}
 
 System::SysWorld::~SysWorld() {
     glDeleteBuffers(1, &m_buffer);
+    glDeleteBuffers(1, &m_index_buffer);
     glDeleteVertexArrays(1, &m_array);
 }
 
-bool System::SysWorld::load(const Game::Game &game) {
+bool System::SysWorld::load(const Game::Game &game,
+                            const Resources &res) {
     bool success = true;
-    const auto &w = game.world();
-    auto vdata = w.vertex_data();
+    const auto &mesh = res.terrain;
 
-    if (!m_prog.load("world", "world")) {
-        success = false;
+    if (TERRAIN_BAKED) {
+        if (!m_prog_baked.load(res.prog_world_baked)) {
+            success = false;
+        }
+    } else {
+        if (!m_prog.load(res.prog_world)) {
+            success = false;
+        }
     }
     glDeleteBuffers(1, &m_buffer);
+    glDeleteBuffers(1, &m_index_buffer);
     glDeleteVertexArrays(1, &m_array);
+    m_buffer_size = 0;
 
-    if (m_prog.is_loaded()) {
+    if (TERRAIN_BAKED && m_prog_baked.is_loaded()) {
+        // The lighting is baked once by Resources, on a worker thread,
+        // so video reinitialization only repeats the upload.
+        const auto &baked = res.terrain_baked;
+        glGenBuffers(1, &m_buffer);
+        glGenBuffers(1, &m_index_buffer);
+        glGenVertexArrays(1, &m_array);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBindVertexArray(m_array);
+        glBufferData(GL_ARRAY_BUFFER, baked.size() * sizeof(BakedVertex),
+                     baked.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+        mesh.upload_index();
+        m_buffer_size = baked.size() * sizeof(BakedVertex) +
+            mesh.index.size() * mesh.index_size();
+        if (m_prog_baked->a_vert >= 0) {
+            glEnableVertexAttribArray(m_prog_baked->a_vert);
+            glVertexAttribPointer(
+                m_prog_baked->a_vert, 4, GL_INT_2_10_10_10_REV, GL_FALSE,
+                12, reinterpret_cast<void *>(0));
+        }
+        if (m_prog_baked->a_color >= 0) {
+            glEnableVertexAttribArray(m_prog_baked->a_color);
+            glVertexAttribPointer(
+                m_prog_baked->a_color, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                12, reinterpret_cast<void *>(4));
+        }
+        if (m_prog_baked->a_light >= 0) {
+            glEnableVertexAttribArray(m_prog_baked->a_light);
+            glVertexAttribPointer(
+                m_prog_baked->a_light, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                12, reinterpret_cast<void *>(8));
+        }
+    } else if (!TERRAIN_BAKED && m_prog.is_loaded()) {
         glGenBuffers(1, &m_buffer);
+        glGenBuffers(1, &m_index_buffer);
         glGenVertexArrays(1, &m_array);
         glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
         glBindVertexArray(m_array);
-        glBufferData(GL_ARRAY_BUFFER,
-                     vdata.second, vdata.first, GL_STATIC_DRAW);
+        mesh.upload_vertex();
+        // The element array binding is part of the vertex array state.
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+        mesh.upload_index();
+        m_buffer_size = mesh.vertex.size() * sizeof(std::uint64_t) +
+            mesh.index.size() * mesh.index_size();
         if (m_prog->a_vert >= 0) {
             glEnableVertexAttribArray(m_prog->a_vert);
             glVertexAttribPointer(
@@ -542,7 +544,38 @@ bool System::SysWorld::load(const Game::Game &game) {
         }
     }
 
-    m_count = (GLsizei) (vdata.second / 8);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    // Without uniform blocks, static data is set once here.
+    auto scale = game.world().vertex_scale();
+    if (TERRAIN_BAKED && m_prog_baked.is_loaded() &&
+        m_prog_baked->u_vertex_scale >= 0) {
+        glUseProgram(m_prog_baked.prog());
+        glUniform3fv(m_prog_baked->u_vertex_scale, 1, scale.v);
+        glUseProgram(0);
+    } else if (!TERRAIN_BAKED && m_prog.is_loaded() &&
+               m_prog->u_vertex_scale >= 0) {
+        Mat3 normalmat = Mat3::identity();
+        TerrainLighting lighting = terrain_lighting(scale);
+        glUseProgram(m_prog.prog());
+        glUniform3fv(m_prog->u_vertex_scale, 1, scale.v);
+        glUniformMatrix3fv(m_prog->u_normalmat, 1, GL_FALSE,
+                           normalmat.data());
+        glUniform4fv(m_prog->u_terrain_color, 8,
+                     &lighting.terrain_color[0].v[0]);
+        glUniform3fv(m_prog->u_light_dir, lighting.light_count,
+                     lighting.light_dir[0]);
+        glUniform3fv(m_prog->u_light_color, lighting.light_count,
+                     lighting.light_color[0]);
+        glUseProgram(0);
+    }
+
+    m_index_type = mesh.index_type();
+    m_index_size = mesh.index_size();
+    m_tile = mesh.tile;
+    m_level_count = mesh.level_count;
 
     sg_opengl_checkerror("SysWorld::load");
     return success;
@@ -553,55 +586,102 @@ void System::SysWorld::draw(const Graphics::FrameData &f) {
 
     auto scale = w.vertex_scale();
     Mat4 modelview = f.worldview * Mat4::scale(scale);
-    Mat3 normalmat = Mat3::identity();
-    Color terrain_color[8] = {
-        Color::palette(1),  Color::palette(2),
-        Color::palette(7), Color::palette(20),
-        Color::palette(3),  Color::palette(3),
-        Color::palette(27),  Color::palette(27)
-    };
-    float height[8] = {
-        -5.0f, +8.0f, 2.5f, 7.0f,
-        -100.0f, -100.0f, -100.0f, -100.0f
-    };
-    for (int i = 0; i < 8; i++) {
-        terrain_color[i].v[3] = height[i] * (1.0f / scale[2]);
-    }
-
-    glUseProgram(m_prog.prog());
-    glBindVertexArray(m_array);
-    glUniformMatrix4fv(m_prog->u_modelview, 1, GL_FALSE,
-                       modelview.data());
-    glUniformMatrix4fv(m_prog->u_projection, 1, GL_FALSE,
-                       f.projection.data());
-    glUniformMatrix3fv(m_prog->u_normalmat, 1, GL_FALSE,
-                       normalmat.data());
-    glUniform4fv(m_prog->u_terrain_color, 8, &terrain_color[0].v[0]);
-    glUniform3fv(m_prog->u_light_dir, LIGHT_COUNT, LIGHT_DIR[0]);
-    glUniform3fv(m_prog->u_light_color, LIGHT_COUNT, LIGHT_COLOR[0]);
-
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-    glDrawArrays(GL_TRIANGLES, 0, m_count);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
+
+    if (TERRAIN_BAKED) {
+        if (!m_prog_baked.is_loaded()) {
+            return;
+        }
+        f.state.use_program(m_prog_baked.prog());
+        f.state.bind_vertex_array(m_array);
+        if (m_prog_baked->u_worldview >= 0) {
+            glUniformMatrix4fv(m_prog_baked->u_worldview, 1, GL_FALSE,
+                               f.worldview.data());
+            glUniformMatrix4fv(m_prog_baked->u_projection, 1, GL_FALSE,
+                               f.projection.data());
+        }
+    } else {
+        if (!m_prog.is_loaded()) {
+            return;
+        }
+        f.state.use_program(m_prog.prog());
+        f.state.bind_vertex_array(m_array);
+        if (m_prog->u_worldview >= 0) {
+            glUniformMatrix4fv(m_prog->u_worldview, 1, GL_FALSE,
+                               f.worldview.data());
+            glUniformMatrix4fv(m_prog->u_projection, 1, GL_FALSE,
+                               f.projection.data());
+        }
+    }
+
+    f.state.set_depth_test(true);
+    f.state.set_cull_face(true);
+    f.state.set_blend(false);
+    f.state.depth_func(GL_LESS);
+    f.state.depth_range(0.0f, 1.0f);
+    {
+        // Draw visible tiles, merging adjacent tiles into one call.
+        Frustum frustum = Frustum::from_matrix(f.projection * modelview);
+        std::size_t first = 0, count = 0;
+        std::size_t level_size = m_tile.size() / m_level_count;
+        for (std::size_t i = 0; i < level_size; i++) {
+            int level = 0;
+            if (m_level_count > 1) {
+                const auto &b = m_tile[i].bounds;
+                Vec3 center;
+                for (int j = 0; j < 3; j++) {
+                    center[j] = 0.5f * scale[j] *
+                        (float) (b.mins[j] + b.maxs[j]);
+                }
+                Vec3 d = center - f.camera_pos;
+                level = std::min(m_level_count - 1,
+                                 terrain_lod(std::sqrt(Vec3::dot(d, d))));
+            }
+            const auto &tile = m_tile[level * level_size + i];
+            if (!frustum.test(tile.bounds)) {
+                continue;
+            }
+            if (count && first + count == tile.first) {
+                count += tile.count;
+                continue;
+            }
+            if (count) {
+                f.state.draw_elements(
+                    GL_TRIANGLES, (GLsizei) count, m_index_type,
+                    first * m_index_size);
+            }
+            first = tile.first;
+            count = tile.count;
+        }
+        if (count) {
+            f.state.draw_elements(
+                GL_TRIANGLES, (GLsizei) count, m_index_type,
+                first * m_index_size);
+        }
+    }
 
     sg_opengl_checkerror("SysWorld::draw");
 }
 
+void System::SysWorld::report_memory(Base::MemoryReport &report) const {
+    report.add("world", m_tile);
+    report.add("world", Base::MemKind::GPU_BUFFER, m_buffer_size);
+}
+
 // ======================================================================
 // Sprites
 // ======================================================================
 
 class System::SysSprite {
 private:
-    Base::Texture m_texture;
     SpriteArray m_sprites;
+    SpriteCache m_cache;
     int m_util_sprite;
+    bool m_instanced;
 
     Base::Program<Shader::Sprite> m_prog;
-    GLuint m_buffer;
+    GLuint m_corner_buffer;
     GLuint m_array;
+    GLint m_first;
     GLsizei m_count;
 
 public:
@@ -610,59 +690,57 @@ public:
     ~SysSprite();
     SysSprite &operator=(const SysSprite &) = delete;
 
-    bool load(const Game::Game &game);
+    bool load(const Game::Game &game, const Resources &res);
     void draw(const FrameData &f);
+    void report_memory(Base::MemoryReport &report) const;
 
 private:
     void update(const FrameData &f);
+    void set_attrib(const FrameData &f);
 };
 
 System::SysSprite::SysSprite()
     : m_util_sprite(-1),
-      m_buffer(0),
+      m_instanced(false),
+      m_corner_buffer(0),
       m_array(0),
+      m_first(0),
       m_count(0) {}
 
 System::SysSprite::~SysSprite() {
-    glDeleteBuffers(1, &m_buffer);
+    glDeleteBuffers(1, &m_corner_buffer);
     glDeleteVertexArrays(1, &m_array);
 }
 
-bool System::SysSprite::load(const Game::Game &game) {
+bool System::SysSprite::load(const Game::Game &game,
+                             const Resources &res) {
     (void) &game;
     bool success = true;
+    // The sprite rectangles move when the atlas is packed.
+    m_cache.clear();
 
-    if (!m_texture.load("image/sprite")) {
-        success = false;
-    } else {
-        glBindTexture(GL_TEXTURE_2D, m_texture.tex);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
-
-    if (!m_prog.load("sprite", "sprite")) {
+    if (!m_prog.load(res.prog_sprite)) {
         success = false;
     }
-    glDeleteBuffers(1, &m_buffer);
+    glDeleteBuffers(1, &m_corner_buffer);
     glDeleteVertexArrays(1, &m_array);
+    m_corner_buffer = 0;
+    m_array = 0;
+
+    // Instanced arrays are core in OpenGL 3.3.  Without them, each
+    // sprite record is written six times, once per corner.
+    m_instanced = GLEW_VERSION_3_3 != 0;
+    Log::info("Sprites: %s",
+              m_instanced ? "instanced" : "not instanced");
 
     if (m_prog.is_loaded()) {
-        glGenBuffers(1, &m_buffer);
         glGenVertexArrays(1, &m_array);
-        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-        glBindVertexArray(m_array);
-        if (m_prog->a_vert >= 0) {
-            glEnableVertexAttribArray(m_prog->a_vert);
-            glVertexAttribPointer(
-                m_prog->a_vert, 3, GL_FLOAT, GL_FALSE,
-                16, reinterpret_cast<void *>(0));
-        }
-        if (m_prog->a_texcoord >= 0) {
-            glEnableVertexAttribArray(m_prog->a_texcoord);
-            glVertexAttribPointer(
-                m_prog->a_texcoord, 4, GL_SHORT, GL_FALSE,
-                16, reinterpret_cast<void *>(12));
+        if (m_instanced) {
+            glGenBuffers(1, &m_corner_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, m_corner_buffer);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(SpriteArray::CORNER),
+                         SpriteArray::CORNER, GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
         }
     }
 
@@ -679,45 +757,60 @@ void System::SysSprite::draw(const Graphics::FrameData &f) {
         return;
     }
 
-    glUseProgram(m_prog.prog());
-    glBindVertexArray(m_array);
-    glUniformMatrix4fv(m_prog->u_modelview, 1, GL_FALSE,
-                       f.worldview.data());
-    glUniformMatrix4fv(m_prog->u_projection, 1, GL_FALSE,
-                       f.projection.data());
-    glUniform2fv(m_prog->u_texscale, 1, m_texture.scale);
+    f.state.use_program(m_prog.prog());
+    f.state.bind_vertex_array(m_array);
+    set_attrib(f);
+    if (m_prog->u_worldview >= 0) {
+        glUniformMatrix4fv(m_prog->u_worldview, 1, GL_FALSE,
+                           f.worldview.data());
+        glUniformMatrix4fv(m_prog->u_projection, 1, GL_FALSE,
+                           f.projection.data());
+        glUniform3fv(m_prog->u_right, 1, f.sprite_right.v);
+        glUniform3fv(m_prog->u_up, 1, f.sprite_up.v);
+    }
+    glUniform2fv(m_prog->u_texscale, 1, f.atlas.scale);
     glUniform1i(m_prog->u_texture, 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_texture.tex);
-
-    glEnable(GL_DEPTH_TEST);
-    glDrawArrays(GL_TRIANGLES, 0, m_count);
-    glDisable(GL_DEPTH_TEST);
+    f.state.bind_texture(0, f.atlas.tex);
+
+    // The parts of a person are at the same depth, and are drawn from
+    // back to front, so later parts must pass the depth test.
+    f.state.set_depth_test(true);
+    f.state.set_cull_face(false);
+    f.state.set_blend(SPRITE_BLEND);
+    if (SPRITE_BLEND) {
+        f.state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    f.state.depth_func(GL_LEQUAL);
+    f.state.depth_range(0.0f, 1.0f);
+    // All parts share the atlas and program, so they are one batch.
+    if (m_instanced) {
+        f.state.draw_arrays_instanced(
+            GL_TRIANGLES, 0, SpriteArray::PART_VERTEX_COUNT, m_count);
+    } else {
+        f.state.draw_arrays(GL_TRIANGLES, 0, m_count);
+    }
 
     sg_opengl_checkerror("SysSprite::draw");
 }
 
 void System::SysSprite::update(const Graphics::FrameData &f) {
     float frac = f.game.frame_frac();
-    Vec3 right =
-        f.camera_angle.transform(Vec3{{SPRITE_SCALE, 0.0f, 0.0f}});
-    Vec3 up = f.camera_angle.transform(Vec3{{0.0f, SPRITE_SCALE, 0.0f}});
+    Vec3 right = f.sprite_right, up = f.sprite_up;
 
     const auto &sd = f.game.sprites();
-    m_sprites.clear();
-    for (const auto &person : f.game.person()) {
-        auto dir = DIRECTION_INFO[static_cast<int>(person.direction())];
-        SpritePart parts[Game::PART_COUNT], *op = parts;
-        for (auto part : person.sprite()) {
-            *op++ = SpritePart {
-                &sd.get_data(part.sprite(), part.frame(), dir.index),
-                part.offset()
-            };
-        }
-        m_sprites.add(parts, (int) (op - parts),
-                      person.position(frac), right, up, dir.orient);
-
-        if (debug_trace) {
+    const auto &people = f.game.person();
+    // Sprites are written directly into the stream buffer, reserve
+    // enough space for every part of every person.
+    unsigned capacity = (unsigned) people.size() *
+        (Game::PART_COUNT + (debug_trace ? 1 : 0)) *
+        (m_instanced ? 1 : SpriteArray::PART_VERTEX_COUNT);
+    m_sprites.begin(
+        f.stream.reserve<SpriteArray::Instance>(capacity), capacity,
+        m_instanced);
+    m_sprites.add_people(m_cache, sd, people, frac, f.worldview, right, up);
+    if (debug_trace) {
+        for (const auto &person : people) {
+            SpritePart parts[1];
             const auto &w = f.game.world();
             auto pos = person.position(frac);
             Vec2 pos2 {{ pos[0], pos[1] }};
@@ -734,14 +827,77 @@ void System::SysSprite::update(const Graphics::FrameData &f) {
         }
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
-    m_sprites.upload(GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (debug_stats) {
+        unsigned composed = m_cache.take_compose_count();
+        if (composed) {
+            Log::info("Sprites: %u of %u people composed",
+                      composed, (unsigned) people.size());
+        }
+    }
 
     m_count = m_sprites.size();
-    m_sprites.clear();
+    m_first = f.stream.commit(m_count);
+    m_sprites.begin(nullptr, 0, m_instanced);
+}
 
-    sg_opengl_checkerror("SysSprite::update");
+void System::SysSprite::set_attrib(const Graphics::FrameData &f) {
+    // Instance attributes can't use a base instance in OpenGL 3, so
+    // the pointers are set every frame to start at this frame's data.
+    typedef SpriteArray::Instance Instance;
+    const GLsizei stride = sizeof(Instance);
+    const std::size_t base = (std::size_t) m_first * stride;
+    glBindBuffer(GL_ARRAY_BUFFER, f.stream.buffer());
+    if (m_prog->a_pos >= 0) {
+        glEnableVertexAttribArray(m_prog->a_pos);
+        glVertexAttribPointer(
+            m_prog->a_pos, 3, GL_FLOAT, GL_FALSE, stride,
+            reinterpret_cast<void *>(base + offsetof(Instance, pos)));
+        if (m_instanced)
+            glVertexAttribDivisor(m_prog->a_pos, 1);
+    }
+    if (m_prog->a_rect >= 0) {
+        glEnableVertexAttribArray(m_prog->a_rect);
+        glVertexAttribPointer(
+            m_prog->a_rect, 4, GL_SHORT, GL_FALSE, stride,
+            reinterpret_cast<void *>(base + offsetof(Instance, rect)));
+        if (m_instanced)
+            glVertexAttribDivisor(m_prog->a_rect, 1);
+    }
+    if (m_prog->a_center >= 0) {
+        glEnableVertexAttribArray(m_prog->a_center);
+        glVertexAttribPointer(
+            m_prog->a_center, 2, GL_SHORT, GL_FALSE, stride,
+            reinterpret_cast<void *>(base + offsetof(Instance, center)));
+        if (m_instanced)
+            glVertexAttribDivisor(m_prog->a_center, 1);
+    }
+    if (m_prog->a_orient >= 0) {
+        glEnableVertexAttribArray(m_prog->a_orient);
+        glVertexAttribIPointer(
+            m_prog->a_orient, 1, GL_UNSIGNED_BYTE, stride,
+            reinterpret_cast<void *>(base + offsetof(Instance, orient)));
+        if (m_instanced)
+            glVertexAttribDivisor(m_prog->a_orient, 1);
+    }
+    if (m_prog->a_corner >= 0) {
+        glEnableVertexAttribArray(m_prog->a_corner);
+        if (m_instanced) {
+            glBindBuffer(GL_ARRAY_BUFFER, m_corner_buffer);
+            glVertexAttribPointer(
+                m_prog->a_corner, 2, GL_UNSIGNED_BYTE, GL_FALSE,
+                0, reinterpret_cast<void *>(0));
+        } else {
+            glVertexAttribPointer(
+                m_prog->a_corner, 2, GL_UNSIGNED_BYTE, GL_FALSE, stride,
+                reinterpret_cast<void *>(
+                    base + offsetof(Instance, corner)));
+        }
+    }
+}
+
+void System::SysSprite::report_memory(Base::MemoryReport &report) const {
+    m_sprites.report_memory(report);
+    m_cache.report_memory(report);
 }
 
 // ======================================================================
@@ -749,8 +905,11 @@ void System::SysSprite::update(const Graphics::FrameData &f) {
 // ======================================================================
 
 System::System()
-    : m_ui(new SysUi),
-      m_text(new SysText),
+    : m_stream(new Base::StreamBuffer),
+      m_state(new State),
+      m_uniforms(new Uniforms),
+      m_atlas(new Base::Texture),
+      m_overlay(new SysOverlay),
       m_world(new SysWorld),
       m_sprite(new SysSprite) {}
 
@@ -758,14 +917,18 @@ System::~System() {}
 
 #define LOAD(s) \
     do { \
-        if (!(m_ ## s)->load(game)) { \
+        Base::Timer timer; \
+        if (!(m_ ## s)->load(game, res)) { \
             Log::warn("Could not load graphics subsystem: %s", #s); \
             success = false; \
         } \
+        Log::info("Graphics::load: %s (GL): %.1f ms", \
+                  #s, timer.elapsed_ms()); \
     } while (0)
 
-bool System::load(const Game::Game &game) {
+bool System::load(Game::Game &game, Resources &res) {
     bool success = true;
+    bool uniform_blocks;
     sg_opengl_checkerror("System::load");
 
     {
@@ -782,6 +945,8 @@ bool System::load(const Game::Game &game) {
         int version = (major << 8) | (minor & 0xff);
         // Mesa does not support GLSL > 1.30.
         // OS X does not support GLSL < 1.40 (unless you go back to 1.20).
+        // Uniform blocks are new in GLSL 1.40.
+        uniform_blocks = version >= 0x0301;
         if (version >= 0x0301) {
             Base::shader_path = "shader/v140";
         } else {
@@ -791,10 +956,40 @@ bool System::load(const Game::Game &game) {
                   major, minor, Base::shader_path.c_str());
     }
 
-    LOAD(ui);
-    LOAD(text);
+    // Read and decode assets on worker threads, then create the
+    // OpenGL objects here on the context thread.
+    if (!res.load(game)) {
+        success = false;
+    }
+
+    m_stream->init(STREAM_SIZE);
+    m_uniforms->init(uniform_blocks);
+    m_uniforms->set_world(world_uniforms(game.world().vertex_scale()));
+
+    // Sprites and the text box share one texture, so they are drawn
+    // without changing the texture binding.
+    bool atlas_ok = !res.atlas_bc1.empty() &&
+        m_atlas->load_bc1(res.atlas_bc1.data(), res.atlas_bc1.size(),
+                          res.atlas.width, res.atlas.height);
+    if (!atlas_ok) {
+        atlas_ok = m_atlas->load(res.atlas);
+    }
+    if (!atlas_ok) {
+        success = false;
+    } else {
+        glBindTexture(GL_TEXTURE_2D, m_atlas->tex);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        m_state->invalidate_textures();
+    }
+
+    LOAD(overlay);
     LOAD(world);
     LOAD(sprite);
+    m_overlay->upload_font();
+    // Loading sets state directly, without the cache.
+    m_state->invalidate();
 
     return success;
 }
@@ -805,18 +1000,63 @@ void System::draw(int width, int height, const Game::Game &game) {
     glClearColor(0.0f, 0.1f, 0.2f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    FrameData f(width, height, game);
+    FrameData f(width, height, game, *m_stream, *m_state, *m_atlas);
+
+    // Each subsystem sets the state it needs, so state is left as it
+    // is between subsystems and between frames.  The cache carries
+    // over between frames, and the program and vertex array are
+    // unbound at the end so sglib's own drawing is not affected.
+    m_state->begin_frame();
+    m_stream->begin_frame();
+
+    if (m_uniforms->enabled()) {
+        Uniforms::Camera camera;
+        std::memcpy(camera.worldview, f.worldview.data(),
+                    sizeof(camera.worldview));
+        std::memcpy(camera.projection, f.projection.data(),
+                    sizeof(camera.projection));
+        for (int i = 0; i < 3; i++) {
+            camera.right[i] = f.sprite_right[i];
+            camera.up[i] = f.sprite_up[i];
+        }
+        camera.right[3] = 0.0f;
+        camera.up[3] = 0.0f;
+        m_uniforms->set_camera(camera);
+    }
 
-    m_ui->draw(f);
-    m_text->draw(f);
+    m_overlay->draw(f);
     m_world->draw(f);
     m_sprite->draw(f);
+    m_stream->end_frame();
+    m_state->end_frame();
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
+    if (debug_stats) {
+        const auto &c = m_state->counters();
+        Log::info("Frame: %u draw calls, %u state changes, %u skipped",
+                  c.draws, c.changes, c.skipped);
+    }
 
     sg_opengl_checkerror("System::draw 1");
 }
 
+void System::report_memory(Base::MemoryReport &report) const {
+    if (m_stream) {
+        report.add("stream", Base::MemKind::GPU_BUFFER, m_stream->size());
+        report.add("stream", Base::MemKind::VECTOR,
+                   m_stream->staging_size());
+    }
+    if (m_atlas) {
+        report.add("sprites", Base::MemKind::GPU_TEXTURE, m_atlas->size);
+    }
+    if (m_overlay) {
+        m_overlay->report_memory(report);
+    }
+    if (m_world) {
+        m_world->report_memory(report);
+    }
+    if (m_sprite) {
+        m_sprite->report_memory(report);
+    }
+}
+
 }
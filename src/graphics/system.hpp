@@ -4,40 +4,52 @@
    information, see LICENSE.txt. */
 #ifndef LD_GRAPHICS_SYSTEM_HPP
 #define LD_GRAPHICS_SYSTEM_HPP
+#include "renderer.hpp"
 #include "shader.hpp"
 #include "sprite.hpp"
 #include "base/image.hpp"
 #include "sg/opengl.h"
 #include "sg/type.h"
 #include <memory>
+namespace Base {
+class StreamBuffer;
+}
 namespace Game {
 class Game;
 }
 namespace Graphics {
+class Resources;
+class State;
+class Uniforms;
 
-/// The graphics system, responsible for drawing everything.
-class System {
+/// The graphics system, responsible for drawing everything with
+/// OpenGL.
+class System : public Renderer {
 private:
-    class SysUi;
-    class SysText;
+    class SysOverlay;
     class SysWorld;
     class SysSprite;
 
-    std::unique_ptr<SysUi> m_ui;
-    std::unique_ptr<SysText> m_text;
+    std::unique_ptr<Base::StreamBuffer> m_stream;
+    std::unique_ptr<State> m_state;
+    std::unique_ptr<Uniforms> m_uniforms;
+    std::unique_ptr<Base::Texture> m_atlas;
+    std::unique_ptr<SysOverlay> m_overlay;
     std::unique_ptr<SysWorld> m_world;
     std::unique_ptr<SysSprite> m_sprite;
 
 public:
     System();
     System(const System &) = delete;
-    ~System();
+    ~System() override;
     System &operator=(const System &) = delete;
 
-    /// Load all graphical assets.
-    bool load(const Game::Game &game);
+    /// Load all graphical assets.  Assets missing from the resource
+    /// cache are loaded first, then everything is uploaded to OpenGL.
+    bool load(Game::Game &game, Resources &res) override;
     /// Draw the game's graphics.
-    void draw(int width, int height, const Game::Game &game);
+    void draw(int width, int height, const Game::Game &game) override;
+    void report_memory(Base::MemoryReport &report) const override;
 };
 
 }
@@ -0,0 +1,352 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "defs.hpp"
+#include "terrain.hpp"
+#include "mesh.hpp"
+#include "game/world.hpp"
+#include "base/task.hpp"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+namespace Graphics {
+
+namespace {
+
+/// Distance at which the first reduced level of detail is used, in
+/// world units.  Each level after that doubles the distance.
+const float LOD_DISTANCE = 160.0f;
+
+/// Vertex coordinates are signed 10-bit integers.
+const int GRID_SIZE = 1 << 10;
+
+/// Minimum depth of the skirts around each tile, in world units.
+const float SKIRT_DEPTH = 1.0f;
+
+int clamp10(float x) {
+    int i = (int) std::floor(x + 0.5f);
+    return std::max(-GRID_SIZE / 2, std::min(GRID_SIZE / 2 - 1, i));
+}
+
+/// Pack a GL_INT_2_10_10_10_REV value.
+std::uint32_t pack(int x, int y, int z, int w) {
+    return ((std::uint32_t) x & 1023) |
+        (((std::uint32_t) y & 1023) << 10) |
+        (((std::uint32_t) z & 1023) << 20) |
+        (((std::uint32_t) w & 3) << 30);
+}
+
+/// Map from vertex coordinates to the terrain type of the nearest
+/// vertex in the full-detail mesh (by taxicab distance).
+class TypeMap {
+private:
+    std::vector<signed char> m_type;
+
+public:
+    void build(const Mesh &full);
+    int get(int x, int y) const {
+        x = std::max(0, std::min(GRID_SIZE - 1, x + GRID_SIZE / 2));
+        y = std::max(0, std::min(GRID_SIZE - 1, y + GRID_SIZE / 2));
+        return m_type[y * GRID_SIZE + x];
+    }
+};
+
+void TypeMap::build(const Mesh &full) {
+    const signed char EMPTY = -128;
+    m_type.assign(GRID_SIZE * GRID_SIZE, EMPTY);
+    std::vector<int> queue;
+    for (auto v : full.vertex) {
+        auto p = vertex_position(v);
+        int idx = (p[1] + GRID_SIZE / 2) * GRID_SIZE + p[0] + GRID_SIZE / 2;
+        if (m_type[idx] != EMPTY)
+            continue;
+        // The W component is the top two bits, signed.
+        m_type[idx] = (signed char) ((std::int32_t) (std::uint32_t) v >> 30);
+        queue.push_back(idx);
+    }
+    if (queue.empty()) {
+        m_type.assign(GRID_SIZE * GRID_SIZE, 0);
+        return;
+    }
+    // Breadth-first flood fill from every vertex at once.
+    for (std::size_t i = 0; i < queue.size(); i++) {
+        int idx = queue[i], x = idx % GRID_SIZE, y = idx / GRID_SIZE;
+        signed char t = m_type[idx];
+        const int nidx[4] = {
+            x > 0 ? idx - 1 : -1,
+            x < GRID_SIZE - 1 ? idx + 1 : -1,
+            y > 0 ? idx - GRID_SIZE : -1,
+            y < GRID_SIZE - 1 ? idx + GRID_SIZE : -1
+        };
+        for (int n : nidx) {
+            if (n >= 0 && m_type[n] == EMPTY) {
+                m_type[n] = t;
+                queue.push_back(n);
+            }
+        }
+    }
+}
+
+/// Parameters shared by all levels.
+struct Params {
+    const Game::World &world;
+    const TypeMap &types;
+    int width, height;
+    Vec2 center;
+    Vec3 scale;
+    int tiles_x, tiles_y;
+
+    /// Get the height at a map cell, in world units.
+    float sample(int x, int y) const {
+        x = std::max(0, std::min(width - 1, x));
+        y = std::max(0, std::min(height - 1, y));
+        return world.height_cell(x, y);
+    }
+
+    /// Get the packed vertex coordinates of a map cell.
+    int vertex_x(int x) const {
+        return clamp10(((float) x - center[0]) / scale[0]);
+    }
+    int vertex_y(int y) const {
+        return clamp10(((float) y - center[1]) / scale[1]);
+    }
+    int vertex_z(int x, int y) const {
+        return clamp10(sample(x, y) / scale[2]);
+    }
+};
+
+/// Generated terrain for one level of detail.
+struct Level {
+    std::vector<std::uint64_t> vertex;
+    std::vector<unsigned> index;
+    std::vector<MeshTile> tile;
+};
+
+/// Get the sample points along one axis of a tile.
+void tile_samples(std::vector<int> &out, int x0, int x1, int step) {
+    out.clear();
+    for (int x = x0; x < x1; x += step)
+        out.push_back(x);
+    out.push_back(x1);
+}
+
+void build_tile(Level &out, const Params &p, int level, int tx, int ty) {
+    const int step = 1 << level;
+    std::vector<int> xs, ys;
+    tile_samples(xs, tx * TERRAIN_TILE_SIZE,
+                 std::min((tx + 1) * TERRAIN_TILE_SIZE, p.width - 1), step);
+    tile_samples(ys, ty * TERRAIN_TILE_SIZE,
+                 std::min((ty + 1) * TERRAIN_TILE_SIZE, p.height - 1), step);
+    const int nx = (int) xs.size(), ny = (int) ys.size();
+
+    const unsigned base = (unsigned) out.vertex.size();
+    const unsigned ibase = (unsigned) out.index.size();
+    std::vector<float> zs(nx * ny);
+    std::vector<std::uint32_t> normal(nx * ny);
+    std::vector<int> wx(nx), wy(ny);
+    float zmin = +1e9f, zmax = -1e9f;
+
+    for (int i = 0; i < nx; i++)
+        wx[i] = p.vertex_x(xs[i]);
+    for (int j = 0; j < ny; j++)
+        wy[j] = p.vertex_y(ys[j]);
+
+    for (int j = 0; j < ny; j++) {
+        int y = ys[j];
+        for (int i = 0; i < nx; i++) {
+            int x = xs[i];
+            float z = p.sample(x, y);
+            zs[j * nx + i] = z;
+            zmin = std::min(zmin, z);
+            zmax = std::max(zmax, z);
+            // Central differences, at this level's spacing.
+            float dx = (p.sample(x + step, y) - p.sample(x - step, y)) /
+                (float) (2 * step);
+            float dy = (p.sample(x, y + step) - p.sample(x, y - step)) /
+                (float) (2 * step);
+            float r = 511.0f / std::sqrt(dx * dx + dy * dy + 1.0f);
+            normal[j * nx + i] = pack(
+                clamp10(-dx * r), clamp10(-dy * r), clamp10(r), 0);
+        }
+    }
+
+    // Surface vertexes, then skirt vertexes around the edge.
+    std::vector<int> edge;
+    for (int i = 0; i < nx - 1; i++)
+        edge.push_back(i);
+    for (int j = 0; j < ny - 1; j++)
+        edge.push_back(j * nx + nx - 1);
+    for (int i = nx - 1; i > 0; i--)
+        edge.push_back((ny - 1) * nx + i);
+    for (int j = ny - 1; j > 0; j--)
+        edge.push_back(j * nx);
+
+    float skirt = std::max(SKIRT_DEPTH, zmax - zmin);
+    for (int k = 0; k < nx * ny + (int) edge.size(); k++) {
+        bool is_skirt = k >= nx * ny;
+        int n = is_skirt ? edge[k - nx * ny] : k;
+        int i = n % nx, j = n / nx;
+        float z = zs[n] - (is_skirt ? skirt : 0.0f);
+        int vx = wx[i], vy = wy[j], vz = clamp10(z / p.scale[2]);
+        int w = p.types.get(vx, vy);
+        out.vertex.push_back(
+            (std::uint64_t) pack(vx, vy, vz, w) |
+            ((std::uint64_t) normal[n] << 32));
+    }
+
+    for (int j = 0; j < ny - 1; j++) {
+        for (int i = 0; i < nx - 1; i++) {
+            unsigned a = j * nx + i, b = a + 1, c = a + nx, d = c + 1;
+            const unsigned tri[6] = { a, b, c, c, b, d };
+            out.index.insert(out.index.end(), tri, tri + 6);
+        }
+    }
+
+    // Skirts face outward.  A crack between two tiles is always
+    // covered by the skirt of the tile on the far side of it.
+    for (int k = 0, n = (int) edge.size(); k < n; k++) {
+        unsigned a = edge[k], b = edge[(k + 1) % n];
+        unsigned as = nx * ny + k, bs = nx * ny + (k + 1) % n;
+        const unsigned tri[6] = { a, as, b, as, bs, b };
+        out.index.insert(out.index.end(), tri, tri + 6);
+    }
+
+    MeshTile mt;
+    mt.first = ibase;
+    mt.count = (unsigned) out.index.size() - ibase;
+    optimize_triangles(&out.index[ibase], mt.count,
+                       out.vertex.size() - base);
+    auto p0 = vertex_position(out.vertex[base]);
+    mt.bounds.mins = p0;
+    mt.bounds.maxs = p0;
+    for (std::size_t k = base; k < out.vertex.size(); k++) {
+        auto q = vertex_position(out.vertex[k]);
+        for (int n = 0; n < 3; n++) {
+            mt.bounds.mins[n] = std::min(mt.bounds.mins[n], q[n]);
+            mt.bounds.maxs[n] = std::max(mt.bounds.maxs[n], q[n]);
+        }
+    }
+    for (int n = 0; n < 3; n++)
+        mt.bounds.maxs[n]++;
+    for (unsigned k = 0; k < mt.count; k++)
+        out.index[ibase + k] += base;
+    out.tile.push_back(mt);
+}
+
+void build_level(Level &out, const Params &p, int level) {
+    for (int ty = 0; ty < p.tiles_y; ty++)
+        for (int tx = 0; tx < p.tiles_x; tx++)
+            build_tile(out, p, level, tx, ty);
+}
+
+/// Check that the full-detail level matches the heightmap around the
+/// edge of the map, where the height lookup is easy to get wrong.
+/// Returns the number of edge cells which do not match.
+int check_edges(const Level &level, const Params &p) {
+    // Expected height of each edge cell, by packed X and Y.  The
+    // highest vertex at a position is the surface, the rest are
+    // skirts.
+    struct Cell {
+        int expect;
+        int found;
+    };
+    std::unordered_map<std::uint32_t, Cell> cells;
+    auto add = [&](int x, int y) {
+        std::uint32_t key = pack(p.vertex_x(x), p.vertex_y(y), 0, 0);
+        cells[key] = Cell { p.vertex_z(x, y), -GRID_SIZE };
+    };
+    for (int x = 0; x < p.width; x++) {
+        add(x, 0);
+        add(x, p.height - 1);
+    }
+    for (int y = 0; y < p.height; y++) {
+        add(0, y);
+        add(p.width - 1, y);
+    }
+    for (std::uint64_t v : level.vertex) {
+        auto it = cells.find((std::uint32_t) v & 0xfffff);
+        if (it == cells.end())
+            continue;
+        int z = vertex_position(v)[2];
+        it->second.found = std::max(it->second.found, z);
+    }
+    int bad = 0;
+    for (const auto &c : cells) {
+        if (c.second.found != c.second.expect)
+            bad++;
+    }
+    return bad;
+}
+
+}
+
+bool build_terrain(Mesh &mesh, const Mesh &full, const Game::World &world) {
+    auto size = world.size();
+    if (size[0] < 2 || size[1] < 2)
+        return false;
+
+    TypeMap types;
+    types.build(full);
+    Params p {
+        world,
+        types,
+        size[0],
+        size[1],
+        world.center(),
+        world.vertex_scale(),
+        (size[0] - 2) / TERRAIN_TILE_SIZE + 1,
+        (size[1] - 2) / TERRAIN_TILE_SIZE + 1
+    };
+
+    Level levels[TERRAIN_LOD_COUNT];
+    {
+        Base::TaskGroup tasks("Graphics::terrain");
+        for (int i = 0; i < TERRAIN_LOD_COUNT; i++) {
+            Level &level = levels[i];
+            tasks.add("level " + std::to_string(i), [&p, &level, i] {
+                build_level(level, p, i);
+            });
+        }
+        tasks.wait();
+    }
+
+    int bad = check_edges(levels[0], p);
+    if (bad)
+        Log::warn("Terrain: %d edge cells do not match the heightmap", bad);
+
+    mesh.vertex.clear();
+    mesh.index.clear();
+    mesh.tile.clear();
+    mesh.level_count = TERRAIN_LOD_COUNT;
+    for (int i = 0; i < TERRAIN_LOD_COUNT; i++) {
+        const Level &level = levels[i];
+        unsigned vbase = (unsigned) mesh.vertex.size();
+        unsigned ibase = (unsigned) mesh.index.size();
+        mesh.vertex.insert(mesh.vertex.end(),
+                           level.vertex.begin(), level.vertex.end());
+        for (unsigned idx : level.index)
+            mesh.index.push_back(idx + vbase);
+        for (MeshTile t : level.tile) {
+            t.first += ibase;
+            mesh.tile.push_back(t);
+        }
+        Log::info("Terrain: level %d: %u vertexes, %u triangles", i,
+                  (unsigned) level.vertex.size(),
+                  (unsigned) (level.index.size() / 3));
+    }
+    return true;
+}
+
+int terrain_lod(float distance) {
+    int level = 0;
+    float limit = LOD_DISTANCE;
+    while (level < TERRAIN_LOD_COUNT - 1 && distance > limit) {
+        level++;
+        limit *= 2.0f;
+    }
+    return level;
+}
+
+}
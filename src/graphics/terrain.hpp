@@ -0,0 +1,31 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_TERRAIN_HPP
+#define LD_GRAPHICS_TERRAIN_HPP
+namespace Game {
+class World;
+}
+namespace Graphics {
+class Mesh;
+
+/// Number of terrain levels of detail.  Each level has half the
+/// resolution of the previous level.
+const int TERRAIN_LOD_COUNT = 4;
+
+/// Size of terrain tiles, in map cells.
+const int TERRAIN_TILE_SIZE = 16;
+
+/// Generate terrain meshes at each level of detail from the world's
+/// heightmap, using worker threads.  Terrain types are copied from the
+/// nearest vertex in the full-detail mesh.  Returns false if the
+/// terrain cannot be generated.
+bool build_terrain(Mesh &mesh, const Mesh &full, const Game::World &world);
+
+/// Select the level of detail for a tile at the given distance from
+/// the camera, in world units.
+int terrain_lod(float distance);
+
+}
+#endif
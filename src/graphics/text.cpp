@@ -0,0 +1,178 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "defs.hpp"
+#include "text.hpp"
+#include "base/memory.hpp"
+#include "base/task.hpp"
+#include "base/timer.hpp"
+#include <cstring>
+#include <unordered_set>
+namespace Graphics {
+
+TextCache::TextCache(std::size_t capacity)
+    : m_capacity(capacity),
+      m_font(nullptr),
+      m_size(0.0f),
+      m_cancel(false),
+      m_done(0),
+      m_running(false) {}
+
+TextCache::~TextCache() {
+    stop();
+    if (m_font) {
+        sg_font_decref(m_font);
+    }
+}
+
+void TextCache::set_font(sg_font *font, float size) {
+    stop();
+    if (font) {
+        sg_font_incref(font);
+    }
+    if (m_font) {
+        sg_font_decref(m_font);
+    }
+    m_font = font;
+    m_size = size;
+    // Layouts have texture coordinates in the old font's texture.
+    m_list.clear();
+    m_map.clear();
+}
+
+std::shared_ptr<const TextLayout> TextCache::get(
+    const char *text, float width) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return get_locked(text, width);
+}
+
+void TextCache::prewarm(std::vector<const char *> text, float width) {
+    stop();
+    if (!m_font || text.empty()) {
+        return;
+    }
+    m_done = 0;
+    m_running = true;
+    // Only workers run the prewarm, so a wait on the main thread
+    // never picks up the whole script.
+    m_tasks.reset(new Base::TaskGroup("Graphics::text", true));
+    m_tasks->add("prewarm", [this, text, width]() {
+        Base::Timer timer;
+        std::size_t count = 0;
+        for (const char *t : text) {
+            if (m_cancel.load()) {
+                break;
+            }
+            // Lock each line separately, so the main thread never
+            // waits for more than one line.
+            std::lock_guard<std::mutex> lock(m_mutex);
+            get_locked(t, width);
+            count++;
+            m_done = count;
+            m_progress.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = false;
+            m_progress.notify_all();
+        }
+        Log::info("Text: laid out %u of %u lines: %.1f ms",
+                  (unsigned) count, (unsigned) text.size(),
+                  timer.elapsed_ms());
+    });
+}
+
+void TextCache::wait(std::size_t count) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_progress.wait(lock, [this, count]() {
+        return !m_running || m_done >= count;
+    });
+}
+
+void TextCache::report_memory(Base::MemoryReport &report) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &e : m_list) {
+        report.add("text", e.second->vert);
+        report.add("text", e.second->batch);
+    }
+}
+
+void TextCache::get_texture(GLuint *texture, float scale[2]) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    sg_font_gettexture(m_font, texture, scale);
+}
+
+std::shared_ptr<const TextLayout> TextCache::get_locked(
+    const char *text, float width) {
+    Key key { text, m_size, width };
+    auto it = m_map.find(key);
+    if (it != m_map.end()) {
+        m_list.splice(m_list.begin(), m_list, it->second);
+        return it->second->second;
+    }
+    if (!m_font) {
+        return nullptr;
+    }
+
+    auto flow = sg_textflow_new(nullptr);
+    if (!flow) {
+        return nullptr;
+    }
+    sg_textflow_setfont(flow, m_font);
+    sg_textflow_setwidth(flow, width);
+    sg_textflow_addtext(flow, text, std::strlen(text));
+    sg_textlayout layout;
+    int r = sg_textlayout_create(&layout, flow, nullptr);
+    sg_textflow_free(flow);
+    if (r) {
+        return nullptr;
+    }
+    std::shared_ptr<TextLayout> value = std::make_shared<TextLayout>();
+    value->vert.assign(layout.vert, layout.vert + layout.vertcount);
+    value->batch.assign(layout.batch, layout.batch + layout.batchcount);
+    value->metrics = layout.metrics;
+    sg_textlayout_destroy(&layout);
+
+    m_list.push_front(Entry(key, value));
+    m_map[key] = m_list.begin();
+    while (m_list.size() > m_capacity) {
+        m_map.erase(m_list.back().first);
+        m_list.pop_back();
+    }
+    return value;
+}
+
+void TextCache::stop() {
+    if (!m_tasks) {
+        return;
+    }
+    m_cancel = true;
+    m_tasks->wait();
+    m_tasks.reset();
+    m_cancel = false;
+}
+
+std::string text_charset(const std::vector<const char *> &text) {
+    std::string result;
+    std::unordered_set<std::string> seen;
+    for (const char *t : text) {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(t);
+        while (*p) {
+            // Keep UTF-8 sequences together, continuation bytes have
+            // the form 10xxxxxx.
+            std::size_t n = 1;
+            while (p[n] && (p[n] & 0xc0) == 0x80)
+                n++;
+            std::string ch(reinterpret_cast<const char *>(p), n);
+            p += n;
+            if (n == 1 && (ch[0] < 0x20 || ch[0] == 0x7f))
+                continue;
+            if (seen.insert(ch).second)
+                result += ch;
+        }
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,112 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_TEXT_HPP
+#define LD_GRAPHICS_TEXT_HPP
+#include "sg/type.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+namespace Base {
+class MemoryReport;
+class TaskGroup;
+}
+namespace Graphics {
+
+/// A line of text which has been laid out.
+struct TextLayout {
+    std::vector<sg_textvert> vert;
+    std::vector<sg_textbatch> batch;
+    sg_textmetrics metrics;
+};
+
+/// Cache of laid out text, which discards the least recently used
+/// layouts first.  Text is identified by its address, so it must not
+/// change while the cache is in use.  Script text never changes.
+///
+/// Text can be laid out ahead of time on a worker thread.  The font
+/// is not thread-safe, so all use of the font goes through the cache.
+class TextCache {
+private:
+    struct Key {
+        const char *text;
+        float size;
+        float width;
+
+        bool operator==(const Key &other) const {
+            return text == other.text && size == other.size &&
+                width == other.width;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &k) const {
+            return std::hash<const char *>()(k.text) ^
+                (std::hash<float>()(k.width) * 31) ^
+                (std::hash<float>()(k.size) * 961);
+        }
+    };
+
+    typedef std::pair<Key, std::shared_ptr<const TextLayout>> Entry;
+
+    std::size_t m_capacity;
+    mutable std::mutex m_mutex;
+    sg_font *m_font;
+    float m_size;
+    std::list<Entry> m_list;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_map;
+    std::atomic<bool> m_cancel;
+    std::unique_ptr<Base::TaskGroup> m_tasks;
+    // Prewarm progress, protected by m_mutex.
+    std::condition_variable m_progress;
+    std::size_t m_done;
+    bool m_running;
+
+public:
+    explicit TextCache(std::size_t capacity);
+    TextCache(const TextCache &) = delete;
+    ~TextCache();
+    TextCache &operator=(const TextCache &) = delete;
+
+    /// Set the font, with the given size in pixels.  The cache keeps
+    /// a reference to the font.
+    void set_font(sg_font *font, float size);
+    /// Test whether the cache has a font.
+    bool has_font() const { return m_font != nullptr; }
+    /// Get the font size, in pixels.
+    float font_size() const { return m_size; }
+    /// Get the layout for text, wrapped to the given width.  Returns
+    /// null if the text could not be laid out.
+    std::shared_ptr<const TextLayout> get(const char *text, float width);
+    /// Start laying out text on a worker thread, so it is cached
+    /// before it is needed.
+    void prewarm(std::vector<const char *> text, float width);
+    /// Wait until the first count entries passed to prewarm() are
+    /// laid out, or the prewarm stops.  The rest continue on the
+    /// worker.
+    void wait(std::size_t count);
+    /// Get the font texture, uploading any new glyphs.
+    void get_texture(GLuint *texture, float scale[2]);
+    /// Add the memory used by the cached layouts to a report.
+    void report_memory(Base::MemoryReport &report) const;
+
+private:
+    std::shared_ptr<const TextLayout> get_locked(
+        const char *text, float width);
+    void stop();
+};
+
+/// Get a string containing each character in the given text once,
+/// in order of first appearance, without control characters.
+std::string text_charset(const std::vector<const char *> &text);
+
+}
+#endif
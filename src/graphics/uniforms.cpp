@@ -0,0 +1,59 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "uniforms.hpp"
+#include "shader.hpp"
+namespace Graphics {
+
+Uniforms::Uniforms()
+    : m_enabled(false),
+      m_camera(0),
+      m_world(0) {}
+
+Uniforms::~Uniforms() {
+    destroy();
+}
+
+void Uniforms::init(bool enabled) {
+    destroy();
+    m_enabled = enabled;
+    if (!enabled)
+        return;
+    glGenBuffers(1, &m_camera);
+    glGenBuffers(1, &m_world);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_camera);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Camera), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_world);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(World), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shader::CAMERA_BLOCK, m_camera);
+    glBindBufferBase(GL_UNIFORM_BUFFER, Shader::WORLD_BLOCK, m_world);
+    sg_opengl_checkerror("Uniforms::init");
+}
+
+void Uniforms::set_camera(const Camera &data) {
+    if (!m_enabled)
+        return;
+    // Orphan the old contents, which may still be in use.
+    glBindBuffer(GL_UNIFORM_BUFFER, m_camera);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Camera), &data, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void Uniforms::set_world(const World &data) {
+    if (!m_enabled)
+        return;
+    glBindBuffer(GL_UNIFORM_BUFFER, m_world);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(World), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void Uniforms::destroy() {
+    glDeleteBuffers(1, &m_camera);
+    glDeleteBuffers(1, &m_world);
+    m_camera = 0;
+    m_world = 0;
+}
+
+}
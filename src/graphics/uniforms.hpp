@@ -0,0 +1,61 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_UNIFORMS_HPP
+#define LD_GRAPHICS_UNIFORMS_HPP
+#include "sg/opengl.h"
+namespace Graphics {
+
+/// Uniform buffers shared by all shader programs.  Programs using
+/// GLSL 1.30 have no uniform blocks, and set the same data as
+/// ordinary uniforms instead.
+class Uniforms {
+public:
+    static const int LIGHT_COUNT = 4;
+
+    /// The "Camera" block, updated every frame.  Layout is std140.
+    struct Camera {
+        float worldview[16];
+        float projection[16];
+        float right[4];
+        float up[4];
+    };
+
+    /// The "World" block, set once when the world is loaded.
+    /// Layout is std140.
+    struct World {
+        float vertex_scale[4];
+        float normalmat[3][4];
+        float terrain_color[8][4];
+        float light_dir[LIGHT_COUNT][4];
+        float light_color[LIGHT_COUNT][4];
+    };
+
+private:
+    bool m_enabled;
+    GLuint m_camera;
+    GLuint m_world;
+
+public:
+    Uniforms();
+    Uniforms(const Uniforms &) = delete;
+    ~Uniforms();
+    Uniforms &operator=(const Uniforms &) = delete;
+
+    /// Create the uniform buffers, if enabled, and bind them to
+    /// their binding points.
+    void init(bool enabled);
+    /// Test whether uniform buffers are used.
+    bool enabled() const { return m_enabled; }
+    /// Set the contents of the "Camera" block.
+    void set_camera(const Camera &data);
+    /// Set the contents of the "World" block.
+    void set_world(const World &data);
+
+private:
+    void destroy();
+};
+
+}
+#endif
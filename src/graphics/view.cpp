@@ -0,0 +1,86 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "view.hpp"
+#include <algorithm>
+#include <cmath>
+namespace Graphics {
+
+namespace {
+
+const float SPRITE_SCALE = 0.2f;
+
+/// Size of the text box, in reference pixels.
+const float BOX_SIZE = 1024.0f;
+
+}
+
+View::View(int width, int height)
+    : width(width), height(height) {
+    // Reference aspect ratio.
+    const double ref_aspect = 16.0 / 9.0, inv_ref_aspect = 9.0 / 16.0;
+    // 35mm equivalent focal length.
+    const double focal = 55.0;
+    // Width of the subject.
+    const double subject_size = 64.0 * 1.4;
+
+    double distance;
+
+    {
+        // We pretend that we are using a 16:9 aspect ratio.
+        double xratio = 18.0 / focal;
+        double yratio = xratio * inv_ref_aspect;
+        distance = 0.5 * subject_size / xratio;
+
+        // Then we expand the FOV to match the actual aspect ratio.
+        double aspect = (double) width / (double) height;
+        if (aspect > ref_aspect) {
+            xratio = yratio * aspect;
+            pixscale = (float) height * (1.0f / 1080.0f);
+        } else {
+            yratio = xratio / aspect;
+            pixscale = (float) width * (1.0f / 1920.0f);
+        }
+
+        projection = Mat4::perspective(
+            (float) xratio,
+            (float) yratio,
+            std::max(1.0f, (float) (distance - 0.5 * subject_size)),
+            (float) (distance + 0.5 * subject_size));
+    }
+
+    // View angle.
+    const double azimuth = 180.0;
+    const double elevation = 40.0;
+
+    {
+        camera_angle =
+            Quat::rotation(
+                Vec3{{0.0f, 0.0f, 1.0f}},
+                (std::atan(1.0) / 45.0) * (180.0 - azimuth)) *
+            Quat::rotation(
+                Vec3{{1.0f, 0.0f, 0.0f}},
+                (std::atan(1.0) / 45.0) * (90.0 - elevation));
+        Vec3 target {{ 0.0f, 0.0f, 2.0f }};
+        Vec3 dir = camera_angle.transform(Vec3{{0.0f, 0.0f, 1.0f}});
+        Vec3 pos = target + dir * (float) distance;
+        camera_pos = pos;
+        worldview = Mat4::rotation(camera_angle.conjugate()) *
+            Mat4::translation(-pos);
+        sprite_right = camera_angle.transform(
+            Vec3{{SPRITE_SCALE, 0.0f, 0.0f}});
+        sprite_up = camera_angle.transform(
+            Vec3{{0.0f, SPRITE_SCALE, 0.0f}});
+    }
+}
+
+void View::textbox(float rect[4]) const {
+    float boxsize = BOX_SIZE * pixscale;
+    rect[0] = -boxsize / (float) width;
+    rect[1] = -1.0f;
+    rect[2] = +boxsize / (float) width;
+    rect[3] = -1.0f + boxsize / (float) height;
+}
+
+}
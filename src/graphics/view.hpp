@@ -0,0 +1,31 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_GRAPHICS_VIEW_HPP
+#define LD_GRAPHICS_VIEW_HPP
+#include "defs.hpp"
+namespace Graphics {
+
+/// The camera and screen layout for a frame.  This only depends on
+/// the size of the window, and is shared by all renderers.
+struct View {
+    int width, height;
+    Mat4 projection;
+    Mat4 worldview;
+    Vec3 camera_pos;
+    Quat camera_angle;
+    /// Vectors from one sprite pixel to the next, in world space.
+    Vec3 sprite_right, sprite_up;
+    /// Size of a reference pixel, in window pixels.
+    float pixscale;
+
+    View(int width, int height);
+
+    /// Get the text box rectangle in normalized device coordinates:
+    /// x0, y0, x1, y1.
+    void textbox(float rect[4]) const;
+};
+
+}
+#endif
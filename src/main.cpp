@@ -7,16 +7,109 @@
 #include "sg/keycode.h"
 #include "sg/mixer.h"
 #include "sg/record.h"
+#include "base/arena.hpp"
+#include "base/cache.hpp"
+#include "base/memory.hpp"
+#include "base/snapshot.hpp"
 #include "game/game.hpp"
+#include "graphics/resources.hpp"
+#include "graphics/soft.hpp"
 #include "graphics/system.hpp"
+#include "base/timer.hpp"
 #include "sg/cvar.h"
+#include <cstdlib>
+#include <cstring>
 using Base::Log;
 
 namespace {
 
 struct sg_cvar_string cv_level;
+struct sg_cvar_string cv_cache;
+struct sg_cvar_string cv_renderer;
+struct sg_cvar_string cv_capture;
+struct sg_cvar_string cv_reference;
 Game::Game *game;
-Graphics::System *graphics;
+Graphics::Renderer *graphics;
+Graphics::SoftRenderer *soft;
+Graphics::Resources *resources;
+
+/// Frame size and count for captures.  Captured frames use a fixed
+/// time step, so the same level always gives the same image.
+const int CAPTURE_WIDTH = 960;
+const int CAPTURE_HEIGHT = 540;
+const int CAPTURE_FRAMES = 120;
+const double CAPTURE_DT = 1.0 / 60.0;
+/// Largest difference in a color channel which still matches the
+/// reference image.
+const int CAPTURE_TOLERANCE = 2;
+int capture_frame;
+double capture_time;
+
+/// Number of frames to draw before checking for heap allocations.
+const int ALLOC_WARMUP_FRAMES = 120;
+int alloc_frames;
+
+/// Write the memory used by each subsystem to the log.
+void log_memory() {
+    Base::MemoryReport report;
+    if (game) {
+        game->report_memory(report);
+    }
+    if (resources) {
+        resources->report_memory(report);
+    }
+    if (graphics) {
+        graphics->report_memory(report);
+    }
+    report.log();
+}
+
+/// Draw a frame at a fixed size and time, and after the last frame,
+/// write it out and compare it to the reference image.  Exits the
+/// program when done.
+void capture_draw() {
+    double time = 1.0 + capture_frame * CAPTURE_DT;
+    game->update(time);
+    Base::Timer timer;
+    graphics->draw(CAPTURE_WIDTH, CAPTURE_HEIGHT, *game);
+    capture_time += timer.elapsed_ms();
+    if (++capture_frame < CAPTURE_FRAMES) {
+        return;
+    }
+
+    Log::info("Capture: %d frames, %.2f ms per frame",
+              capture_frame, capture_time / capture_frame);
+    const auto &pixels = soft->pixels();
+    Base::Snapshot frame;
+    frame.copy_rgba(pixels->data, pixels->rowbytes,
+                    pixels->width, pixels->height);
+    if (!frame.write(cv_capture.value)) {
+        Log::abort("%s: Could not write capture.", cv_capture.value);
+    }
+    if (*cv_reference.value) {
+        Base::Snapshot reference;
+        if (!reference.read(cv_reference.value)) {
+            Log::abort("%s: Could not read reference image.",
+                       cv_reference.value);
+        }
+        Base::SnapshotDiff diff;
+        if (!Base::snapshot_diff(&diff, frame, reference,
+                                 CAPTURE_TOLERANCE)) {
+            Log::abort("Capture is %dx%d, reference is %dx%d.",
+                       frame.width, frame.height,
+                       reference.width, reference.height);
+        }
+        if (diff.count) {
+            Log::abort("Capture differs from reference: "
+                       "%lu pixels, max error %d.",
+                       diff.count, diff.max_error);
+        }
+        Log::info("Capture matches reference, max error %d.",
+                  diff.max_error);
+    }
+    Log::flush();
+    std::exit(0);
+}
 
 }
 
@@ -24,6 +117,21 @@ void sg_game_init(void) {
     sg_mixer_start();
     sg_cvar_defstring(nullptr, "level", "Initial level.",
                       &cv_level, "ch1", 0);
+    sg_cvar_defstring(nullptr, "cache",
+                      "Directory for cached data, empty to disable.",
+                      &cv_cache, "cache", 0);
+    sg_cvar_defstring(nullptr, "renderer",
+                      "Renderer: gl, soft, or headless, which is soft "
+                      "without showing the frames.",
+                      &cv_renderer, "gl", 0);
+    sg_cvar_defstring(nullptr, "capture",
+                      "Draw with the software renderer, write a frame "
+                      "to this PPM file, and exit.",
+                      &cv_capture, "", 0);
+    sg_cvar_defstring(nullptr, "reference",
+                      "Reference PPM file to compare the capture to.",
+                      &cv_reference, "", 0);
+    Base::cache_path = cv_cache.value;
     game = new Game::Game;
     if (!game->load()) {
         Log::abort("Could not load game data.");
@@ -33,7 +141,10 @@ void sg_game_init(void) {
     }
 }
 
-void sg_game_destroy(void) {}
+void sg_game_destroy(void) {
+    log_memory();
+    Log::flush();
+}
 
 void sg_game_getinfo(struct sg_game_info *info) {
     info->name = "Legend of Feleria";
@@ -43,16 +154,33 @@ void sg_game_getinfo(struct sg_game_info *info) {
 
 void sg_game_event(union sg_event *evt) {
     switch (evt->common.type) {
-    case SG_EVENT_VIDEO_INIT:
+    case SG_EVENT_VIDEO_INIT: {
+        // The resources survive the old context, so only the GL
+        // objects are recreated here.
+        Base::Timer timer;
         if (graphics) {
             delete graphics;
             graphics = nullptr;
+            soft = nullptr;
         }
-        graphics = new Graphics::System;
-        if (!graphics->load(*game)) {
+        if (!resources) {
+            resources = new Graphics::Resources;
+        }
+        bool present = !std::strcmp(cv_renderer.value, "soft");
+        if (present || *cv_capture.value ||
+            !std::strcmp(cv_renderer.value, "headless")) {
+            soft = new Graphics::SoftRenderer(present);
+            graphics = soft;
+        } else {
+            graphics = new Graphics::System;
+        }
+        if (!graphics->load(*game, *resources)) {
             Log::abort("Could not load graphics data.");
         }
+        Log::info("Video init: %.1f ms", timer.elapsed_ms());
+        alloc_frames = 0;
         break;
+    }
 
     case SG_EVENT_KDOWN:
         switch (evt->key.key) {
@@ -60,6 +188,10 @@ void sg_game_event(union sg_event *evt) {
             sg_record_screenshot();
             return;
 
+        case KEY_F9:
+            log_memory();
+            return;
+
         case KEY_F10:
             sg_record_start(evt->common.time);
             return;
@@ -78,8 +210,29 @@ void sg_game_event(union sg_event *evt) {
 }
 
 void sg_game_draw(int width, int height, double time) {
+    Base::frame_arena.reset();
+    if (*cv_capture.value) {
+        capture_draw();
+        return;
+    }
+    unsigned long allocs = Base::heap_alloc_count();
     sg_mixer_settime(time);
     game->update(time);
     sg_mixer_commit();
     graphics->draw(width, height, *game);
+
+    // Once everything is loaded and the caches are warm, frames should
+    // not touch the heap.  Dialog and level changes still allocate
+    // (text layouts, font loads), so this is a warning.
+    if (Base::ALLOC_COUNT) {
+        if (alloc_frames < ALLOC_WARMUP_FRAMES) {
+            alloc_frames++;
+        } else {
+            allocs = Base::heap_alloc_count() - allocs;
+            if (allocs) {
+                static Base::LogLimit limit;
+                Log::warn(limit, "Frame made %lu heap allocations.", allocs);
+            }
+        }
+    }
 }
@@ -0,0 +1,79 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "mat_ref.hpp"
+#include "base/timer.hpp"
+#include <cstdio>
+#include <vector>
+using Base::Mat4;
+using Base::Vec3;
+
+namespace {
+
+const int POINT_COUNT = 4096;
+const int REPEAT = 2000;
+
+/// Print the time per operation, and a value so the work is kept.
+void report(const char *name, double ms, double ops, float sink) {
+    std::printf("%-24s %7.2f ns/op  (%g)\n",
+                name, ms * 1e6 / ops, (double) sink);
+}
+
+}
+
+int main() {
+    Base::RandomStream rand(2, 0);
+    std::vector<Mat4> mats(POINT_COUNT);
+    std::vector<Vec3> points(POINT_COUNT);
+    for (int i = 0; i < POINT_COUNT; i++) {
+        mats[i] = Ref::random_mat(rand);
+        points[i] = Ref::random_vec(rand);
+    }
+    std::vector<float> out((std::size_t) POINT_COUNT * 4);
+    float (*out4)[4] = reinterpret_cast<float (*)[4]>(out.data());
+    const double ops = (double) POINT_COUNT * REPEAT;
+
+    {
+        Base::Timer timer;
+        float sink = 0.0f;
+        for (int r = 0; r < REPEAT; r++) {
+            for (int i = 0; i < POINT_COUNT; i++) {
+                Mat4 z = mats[i] * mats[(i + r) % POINT_COUNT];
+                sink += z.m[i & 3][r & 3];
+            }
+        }
+        report("Mat4 multiply", timer.elapsed_ms(), ops, sink);
+    }
+    {
+        Base::Timer timer;
+        float sink = 0.0f;
+        for (int r = 0; r < REPEAT; r++) {
+            for (int i = 0; i < POINT_COUNT; i++) {
+                Mat4 z = Ref::mul(mats[i], mats[(i + r) % POINT_COUNT]);
+                sink += z.m[i & 3][r & 3];
+            }
+        }
+        report("Mat4 multiply (scalar)", timer.elapsed_ms(), ops, sink);
+    }
+    {
+        Base::Timer timer;
+        float sink = 0.0f;
+        for (int r = 0; r < REPEAT; r++) {
+            mats[r].transform_points(out4, points.data(), POINT_COUNT);
+            sink += out[r];
+        }
+        report("transform_points", timer.elapsed_ms(), ops, sink);
+    }
+    {
+        Base::Timer timer;
+        float sink = 0.0f;
+        for (int r = 0; r < REPEAT; r++) {
+            Ref::transform_points(out4, mats[r], points.data(),
+                                  POINT_COUNT);
+            sink += out[r];
+        }
+        report("transform_points (scalar)", timer.elapsed_ms(), ops, sink);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "base/random.hpp"
+#include "base/timer.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+using Base::RandomStream;
+
+namespace {
+
+const std::size_t COUNT = 1 << 16;
+const int REPEAT = 400;
+
+/// Print the throughput, and a value so the work is kept.
+void report(const char *name, double ms, std::uint32_t sink) {
+    double total = (double) COUNT * REPEAT;
+    std::printf("%-20s %6.3f Gnum/s  (%08x)\n",
+                name, total / (ms * 1e6), (unsigned) sink);
+}
+
+}
+
+int main() {
+    std::vector<std::uint32_t> out(COUNT);
+    std::vector<float> fout(COUNT);
+    {
+        RandomStream rand(1, 0);
+        Base::Timer timer;
+        std::uint32_t sink = 0;
+        for (int r = 0; r < REPEAT; r++) {
+            for (std::size_t i = 0; i < COUNT; i++) {
+                sink ^= rand.next();
+            }
+        }
+        report("next", timer.elapsed_ms(), sink);
+    }
+    {
+        RandomStream rand(1, 0);
+        Base::Timer timer;
+        std::uint32_t sink = 0;
+        for (int r = 0; r < REPEAT; r++) {
+            rand.fill(out.data(), COUNT);
+            sink ^= out[r];
+        }
+        report("fill", timer.elapsed_ms(), sink);
+    }
+    {
+        RandomStream rand(1, 0);
+        Base::Timer timer;
+        float sink = 0.0f;
+        for (int r = 0; r < REPEAT; r++) {
+            for (std::size_t i = 0; i < COUNT; i++) {
+                sink += rand.nextf();
+            }
+        }
+        report("nextf", timer.elapsed_ms(), (std::uint32_t) sink);
+    }
+    {
+        RandomStream rand(1, 0);
+        Base::Timer timer;
+        float sink = 0.0f;
+        for (int r = 0; r < REPEAT; r++) {
+            rand.fillf(fout.data(), COUNT);
+            sink += fout[r];
+        }
+        report("fillf", timer.elapsed_ms(), (std::uint32_t) sink);
+    }
+    {
+        Base::Random rand;
+        rand.init();
+        Base::Timer timer;
+        std::uint32_t sink = 0;
+        for (int r = 0; r < REPEAT; r++) {
+            for (std::size_t i = 0; i < COUNT; i++) {
+                sink ^= rand.next();
+            }
+        }
+        report("xorshift next", timer.elapsed_ms(), sink);
+    }
+    return 0;
+}
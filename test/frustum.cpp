@@ -0,0 +1,60 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "test.hpp"
+#include "graphics/frustum.hpp"
+using Base::IBox3;
+using Base::Mat4;
+using Graphics::Frustum;
+
+namespace {
+
+IBox3 box(int x0, int y0, int z0, int x1, int y1, int z1) {
+    return IBox3 {{{ x0, y0, z0 }}, {{ x1, y1, z1 }}};
+}
+
+}
+
+int main() {
+    // Camera at the origin looking down -Z, 90 degree field of view,
+    // near plane at 2 and far plane at 20.
+    Frustum f = Frustum::from_matrix(
+        Mat4::perspective(1.0f, 1.0f, 2.0f, 20.0f));
+
+    // Inside.
+    CHECK(f.test(box(-1, -1, -6, 1, 1, -4)));
+    CHECK(f.test(box(-100, -100, -19, 100, 100, -3)));
+
+    // Outside each side plane.
+    CHECK(!f.test(box(-20, -1, -6, -15, 1, -4)));
+    CHECK(!f.test(box(15, -1, -6, 20, 1, -4)));
+    CHECK(!f.test(box(-1, -20, -6, 1, -15, -4)));
+    CHECK(!f.test(box(-1, 15, -6, 1, 20, -4)));
+
+    // Straddling each side plane.
+    CHECK(f.test(box(-10, -1, -6, 0, 1, -4)));
+    CHECK(f.test(box(0, -1, -6, 10, 1, -4)));
+    CHECK(f.test(box(-1, -10, -6, 1, 0, -4)));
+    CHECK(f.test(box(-1, 0, -6, 1, 10, -4)));
+
+    // Near plane: behind the camera, between the camera and the near
+    // plane, and straddling the near plane.
+    CHECK(!f.test(box(-1, -1, 1, 1, 1, 3)));
+    CHECK(!f.test(box(-1, -1, -1, 1, 1, 0)));
+    CHECK(f.test(box(-1, -1, -3, 1, 1, -1)));
+
+    // Far plane: beyond it, and straddling it.
+    CHECK(!f.test(box(-1, -1, -30, 1, 1, -25)));
+    CHECK(f.test(box(-1, -1, -25, 1, 1, -15)));
+
+    // The planes are in model coordinates, so moving the camera
+    // moves the frustum.
+    Frustum g = Frustum::from_matrix(
+        Mat4::perspective(1.0f, 1.0f, 2.0f, 20.0f) *
+        Mat4::translation(Base::Vec3 {{ -50.0f, 0.0f, 0.0f }}));
+    CHECK(!g.test(box(-1, -1, -6, 1, 1, -4)));
+    CHECK(g.test(box(49, -1, -6, 51, 1, -4)));
+
+    return Test::finish("frustum");
+}
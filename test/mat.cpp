@@ -0,0 +1,52 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "test.hpp"
+#include "mat_ref.hpp"
+#include "base/random.hpp"
+#include <cstring>
+using Base::Mat4;
+using Base::Vec3;
+
+namespace {
+
+const int ITERATIONS = 100000;
+
+}
+
+// The SIMD kernels must give exactly the same results as the scalar
+// code, so the renderers agree on every platform.
+int main() {
+    Base::RandomStream rand(1, 0);
+    int bad_mul = 0, bad_points = 0;
+    for (int n = 0; n < ITERATIONS; n++) {
+        Mat4 x = Ref::random_mat(rand), y = Ref::random_mat(rand);
+        Mat4 z = x * y, zr = Ref::mul(x, y);
+        if (std::memcmp(z.m, zr.m, sizeof(z.m))) {
+            bad_mul++;
+        }
+
+        Vec3 v[3];
+        for (auto &p : v) {
+            p = Ref::random_vec(rand);
+        }
+        float out[3][4], outr[3][4];
+        x.transform_points(out, v, 3);
+        Ref::transform_points(outr, x, v, 3);
+        if (std::memcmp(out, outr, sizeof(out))) {
+            bad_points++;
+        }
+    }
+    CHECK(bad_mul == 0);
+    CHECK(bad_points == 0);
+
+    // Transforming a point matches Mat4::transform.
+    Mat4 m = Ref::random_mat(rand);
+    Vec3 p = Ref::random_vec(rand), t = m.transform(p);
+    float out[1][4];
+    m.transform_points(out, &p, 1);
+    CHECK(!std::memcmp(out[0], &t, sizeof(t)));
+
+    return Test::finish("mat");
+}
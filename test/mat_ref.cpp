@@ -0,0 +1,59 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "mat_ref.hpp"
+namespace Ref {
+
+namespace {
+
+float random_float(Base::RandomStream &rand) {
+    return rand.nextf() * 8.0f - 4.0f;
+}
+
+}
+
+Base::Mat4 random_mat(Base::RandomStream &rand) {
+    Base::Mat4 m;
+    for (auto &c : m.m) {
+        for (auto &x : c) {
+            x = random_float(rand);
+        }
+    }
+    return m;
+}
+
+Base::Vec3 random_vec(Base::RandomStream &rand) {
+    Base::Vec3 v;
+    for (int i = 0; i < 3; i++) {
+        v[i] = random_float(rand) * 100.0f;
+    }
+    return v;
+}
+
+Base::Mat4 mul(const Base::Mat4 &x, const Base::Mat4 &y) {
+    Base::Mat4 z;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            z.m[j][i] =
+                x.m[0][i] * y.m[j][0] +
+                x.m[1][i] * y.m[j][1] +
+                x.m[2][i] * y.m[j][2] +
+                x.m[3][i] * y.m[j][3];
+        }
+    }
+    return z;
+}
+
+void transform_points(float (*out)[4], const Base::Mat4 &m,
+                      const Base::Vec3 *in, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        Base::Vec3 v = in[i];
+        for (int j = 0; j < 4; j++) {
+            out[i][j] = v[0] * m.m[0][j] + v[1] * m.m[1][j] +
+                v[2] * m.m[2][j] + m.m[3][j];
+        }
+    }
+}
+
+}
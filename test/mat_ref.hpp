@@ -0,0 +1,25 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_TEST_MAT_REF_HPP
+#define LD_TEST_MAT_REF_HPP
+#include "base/mat.hpp"
+#include "base/random.hpp"
+#include <cstddef>
+/// Scalar reference versions of the matrix kernels, which add the
+/// products in the same order as the SIMD versions.  They are in a
+/// separate file so the benchmarks compare calls to calls.
+namespace Ref {
+
+/// Random matrix, -4 <= x < 4.
+Base::Mat4 random_mat(Base::RandomStream &rand);
+/// Random point, -400 <= x < 400.
+Base::Vec3 random_vec(Base::RandomStream &rand);
+
+Base::Mat4 mul(const Base::Mat4 &x, const Base::Mat4 &y);
+void transform_points(float (*out)[4], const Base::Mat4 &m,
+                      const Base::Vec3 *in, std::size_t count);
+
+}
+#endif
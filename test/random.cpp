@@ -0,0 +1,150 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "test.hpp"
+#include "base/random.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using Base::RandomStream;
+
+namespace {
+
+/// Known-answer vectors for Philox4x32-10, from the Random123
+/// distribution (kat_vectors).
+struct Vector {
+    std::uint32_t ctr[4];
+    std::uint32_t key[2];
+    std::uint32_t out[4];
+};
+
+const Vector VECTORS[] = {
+    {{ 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+     { 0x00000000, 0x00000000 },
+     { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 }},
+    {{ 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+     { 0xffffffff, 0xffffffff },
+     { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd }},
+    {{ 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 },
+     { 0xa4093822, 0x299f31d0 },
+     { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }}
+};
+
+/// Get numbers one at a time, for comparing with fill().
+std::vector<std::uint32_t> generate(RandomStream rand, std::size_t count) {
+    std::vector<std::uint32_t> out(count);
+    for (auto &x : out) {
+        x = rand.next();
+    }
+    return out;
+}
+
+}
+
+int main() {
+    for (const auto &v : VECTORS) {
+        std::uint32_t out[4];
+        RandomStream::block(out, v.key, v.ctr);
+        CHECK(!std::memcmp(out, v.out, sizeof(out)));
+    }
+
+    // The stream is the sequence of blocks for counters 0, 1, 2...
+    // with the stream number in the high words.
+    {
+        const std::uint64_t seed = 0x0123456789abcdefull;
+        const std::uint64_t stream = 0xfedcba9876543210ull;
+        RandomStream rand(seed, stream);
+        const std::uint32_t key[2] = { 0x89abcdef, 0x01234567 };
+        for (std::uint32_t i = 0; i < 3; i++) {
+            const std::uint32_t ctr[4] = { i, 0, 0x76543210, 0xfedcba98 };
+            std::uint32_t out[4];
+            RandomStream::block(out, key, ctr);
+            for (int j = 0; j < 4; j++) {
+                CHECK(rand.next() == out[j]);
+            }
+        }
+    }
+
+    // fill() and fillf() match next() and nextf(), starting at any
+    // position in a block, for any length.
+    const std::size_t LENGTH = 300;
+    std::vector<std::uint32_t> expect = generate(RandomStream(7, 3), LENGTH);
+    int bad_fill = 0, bad_fillf = 0, bad_seek = 0;
+    for (std::size_t start = 0; start < 8; start++) {
+        for (std::size_t n = 0; start + n <= LENGTH; n += 37) {
+            RandomStream a(7, 3), b(7, 3);
+            for (std::size_t i = 0; i < start; i++) {
+                a.next();
+                b.next();
+            }
+            std::vector<std::uint32_t> out(n + 1);
+            a.fill(out.data(), n);
+            if (n && std::memcmp(out.data(), &expect[start],
+                                 n * sizeof(std::uint32_t))) {
+                bad_fill++;
+            }
+            if (start + n < LENGTH && a.next() != expect[start + n]) {
+                bad_fill++;
+            }
+            std::vector<float> fout(n + 1);
+            b.fillf(fout.data(), n);
+            for (std::size_t i = 0; i < n; i++) {
+                float f = (float) (expect[start + i] >> 8) *
+                    (1.0f / 16777216.0f);
+                if (fout[i] != f || !(f >= 0.0f && f < 1.0f)) {
+                    bad_fillf++;
+                }
+            }
+        }
+    }
+    for (std::size_t pos = 0; pos < LENGTH; pos += 13) {
+        RandomStream rand(7, 3);
+        rand.seek(pos);
+        if (rand.next() != expect[pos]) {
+            bad_seek++;
+        }
+    }
+    CHECK(bad_fill == 0);
+    CHECK(bad_fillf == 0);
+    CHECK(bad_seek == 0);
+
+    // The low counter word carries into the high word, in both the
+    // single-block and four-block code.
+    {
+        const std::uint64_t pos = ((std::uint64_t) 1 << 34) - 8;
+        RandomStream a(5, 0), b(5, 0);
+        a.seek(pos);
+        b.seek(pos);
+        std::uint32_t out[32];
+        a.fill(out, 32);
+        int bad = 0;
+        for (auto x : out) {
+            if (b.next() != x) {
+                bad++;
+            }
+        }
+        CHECK(bad == 0);
+        const std::uint32_t key[2] = { 5, 0 };
+        const std::uint32_t ctr[4] = { 0, 1, 0, 0 };
+        std::uint32_t block[4];
+        RandomStream::block(block, key, ctr);
+        CHECK(!std::memcmp(out + 8, block, sizeof(block)));
+    }
+
+    // nexti() stays in range.
+    {
+        RandomStream rand(1, 1);
+        int bad = 0;
+        for (int i = 0; i < 10000; i++) {
+            int x = rand.nexti(7);
+            if (x < 0 || x >= 7) {
+                bad++;
+            }
+        }
+        CHECK(bad == 0);
+        CHECK(rand.nexti(1) == 0);
+    }
+
+    return Test::finish("random");
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# Copyright 2014 Dietrich Epp.
+"""Build and run the unit tests and benchmarks.
+
+The tests only cover code which does not depend on sglib, so they are
+built directly with the host C++ compiler instead of through the game
+build.  Set CXX to choose the compiler.
+"""
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+from os.path import dirname, join
+
+ROOT = dirname(dirname(os.path.abspath(__file__)))
+
+# Each program lists its own source file and the sources it tests.
+# Programs run in a temporary directory, where they can write files.
+TESTS = {
+    'frustum': ['test/frustum.cpp', 'src/graphics/frustum.cpp',
+                'src/base/mat.cpp', 'src/base/quat.cpp'],
+    'mat': ['test/mat.cpp', 'test/mat_ref.cpp', 'src/base/mat.cpp',
+            'src/base/quat.cpp', 'src/base/random.cpp'],
+    'random': ['test/random.cpp', 'src/base/random.cpp'],
+    'snapshot': ['test/snapshot.cpp', 'src/base/snapshot.cpp'],
+}
+
+BENCHMARKS = {
+    'mat': ['test/bench_mat.cpp', 'test/mat_ref.cpp', 'src/base/mat.cpp',
+            'src/base/quat.cpp', 'src/base/random.cpp'],
+    'random': ['test/bench_random.cpp', 'src/base/random.cpp'],
+}
+
+def build(name, sources, outdir):
+    exe = join(outdir, name)
+    cxx = os.environ.get('CXX', 'c++')
+    cmd = [cxx, '-std=c++11', '-O2', '-Wall', '-Wextra',
+           '-I' + join(ROOT, 'src'), '-o', exe]
+    cmd.extend(join(ROOT, src) for src in sources)
+    cmd.append('-lpthread')
+    subprocess.check_call(cmd)
+    return exe
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__)
+    p.add_argument('--bench', action='store_true',
+                   help='run the benchmarks instead of the tests')
+    p.add_argument('names', nargs='*', help='programs to run')
+    args = p.parse_args()
+    programs = BENCHMARKS if args.bench else TESTS
+    names = args.names or sorted(programs)
+    failed = []
+    with tempfile.TemporaryDirectory() as outdir:
+        for name in names:
+            if name not in programs:
+                p.error('unknown program: {}'.format(name))
+            print('==> {}'.format(name), flush=True)
+            try:
+                exe = build(name, programs[name], outdir)
+                subprocess.check_call([exe], cwd=outdir)
+            except subprocess.CalledProcessError:
+                failed.append(name)
+    if failed:
+        print('FAILED: {}'.format(' '.join(failed)))
+        sys.exit(1)
+    print('OK')
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,52 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#include "test.hpp"
+#include "base/snapshot.hpp"
+#include <cstdio>
+using Base::Snapshot;
+using Base::SnapshotDiff;
+
+int main() {
+    // A 3x2 RGBA image with padded rows.
+    const int width = 3, height = 2, rowbytes = 16;
+    unsigned char rgba[rowbytes * height];
+    for (int i = 0; i < rowbytes * height; i++) {
+        rgba[i] = (unsigned char) (i * 7);
+    }
+    Snapshot a;
+    a.copy_rgba(rgba, rowbytes, width, height);
+    CHECK(a.width == width && a.height == height);
+    CHECK(a.data.size() == width * height * 3);
+    CHECK(a.data[0] == rgba[0] && a.data[2] == rgba[2]);
+    CHECK(a.data[3] == rgba[4]);
+    CHECK(a.data[9] == rgba[rowbytes]);
+
+    // Round trip through a file.
+    const char *path = "snapshot.ppm";
+    CHECK(a.write(path));
+    Snapshot b;
+    CHECK(b.read(path));
+    CHECK(b.width == width && b.height == height && b.data == a.data);
+    std::remove(path);
+    CHECK(!b.read(path));
+
+    // Differences.
+    SnapshotDiff diff;
+    CHECK(Base::snapshot_diff(&diff, a, a, 0));
+    CHECK(diff.count == 0 && diff.max_error == 0);
+    b = a;
+    b.data[4] += 3;
+    b.data[15] -= 10;
+    CHECK(Base::snapshot_diff(&diff, a, b, 0));
+    CHECK(diff.count == 2 && diff.max_error == 10);
+    CHECK(Base::snapshot_diff(&diff, a, b, 3));
+    CHECK(diff.count == 1 && diff.max_error == 10);
+    CHECK(Base::snapshot_diff(&diff, a, b, 10));
+    CHECK(diff.count == 0);
+    b.width = 2;
+    CHECK(!Base::snapshot_diff(&diff, a, b, 255));
+
+    return Test::finish("snapshot");
+}
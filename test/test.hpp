@@ -0,0 +1,39 @@
+/* Copyright 2014 Dietrich Epp.
+   This file is part of Legend of Feleria.  Legend of Feleria is
+   licensed under the terms of the 2-clause BSD license.  For more
+   information, see LICENSE.txt. */
+#ifndef LD_TEST_TEST_HPP
+#define LD_TEST_TEST_HPP
+#include <cstdio>
+namespace Test {
+
+/// Get the number of failed checks.
+inline int &failure_count() {
+    static int count;
+    return count;
+}
+
+/// Record the result of a check.
+inline void check(bool cond, const char *expr, const char *file, int line) {
+    if (cond)
+        return;
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+    failure_count()++;
+}
+
+/// Print the result, and get the exit status for main().
+inline int finish(const char *name) {
+    int n = failure_count();
+    if (n) {
+        std::fprintf(stderr, "%s: %d checks failed\n", name, n);
+        return 1;
+    }
+    std::printf("%s: ok\n", name);
+    return 0;
+}
+
+}
+
+#define CHECK(x) Test::check((x), #x, __FILE__, __LINE__)
+
+#endif